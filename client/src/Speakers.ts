@@ -26,6 +26,10 @@ export default class Speakers {
         this._scriptNode.connect(this._audioContext.destination);
 
         console.log("Sample Rate: " + this._audioContext.sampleRate);
+        window.emulator.setSampleFrequency(this._audioContext.sampleRate);
+        // EmuScreen shows a frame every 16.67ms rather than at the NES's 60.1fps,
+        // so each frame's audio has to last that long or we slowly run dry
+        window.emulator.setAudioFrameRate(60);
         this._started = true;
     }
 
@@ -49,6 +53,14 @@ export default class Speakers {
         this._buffer.enq(sample);
     }
 
+    // Copies the first count samples out of a view into the emulator's
+    // audio buffer, which gets overwritten on the next run call
+    public writeSamples(samples: Float32Array, count: number): void {
+        for (let i = 0; i < count; i++) {
+            this._buffer.enq(samples[i]);
+        }
+    }
+
     public size(): number {
         return this._buffer.size();
     }
@@ -85,8 +97,12 @@ export default class Speakers {
                 // // WILL STOP THE MAIN CLOCKER FROM RENDERING THE FRAME ON THIS DRAW CALL)
 
                 // // Generate enough samples to fill the buffer and then generate 2048 more
-                for (let i = 0; i < output.length - samples.length + 2048; i++) {
-                    this.writeSample(window.emulator.emulateSample());
+                const emu = window.emulator;
+                let needed = output.length - samples.length + 2048;
+                while (needed > 0) {
+                    const nsamples = emu.runUntilSamples(needed);
+                    this.writeSamples(emu.getAudioBuffer(), nsamples);
+                    needed -= nsamples;
                 }
 
                 const leftoverSamples = this._buffer.deqN(output.length - samples.length);
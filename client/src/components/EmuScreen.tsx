@@ -126,10 +126,10 @@ const EmuScreen: React.FC<IEmuScreenProps> = (props) => {
                     // THE BUFFER SHOULD BE BIG ENOUGH TO
                     // AVOID THIS ISSUE
 
-                    const sample = emu.emulateSample();
-                    speakers.writeSample(sample);
-                    // speakers.writeSample(sample);
-                    samplesProvided++;
+                    // Normally the whole frame's audio fits in one call
+                    const nsamples = emu.runFrame();
+                    speakers.writeSamples(emu.getAudioBuffer(), nsamples);
+                    samplesProvided += nsamples;
                 }
                 emu.clearFrameComplete();
                 window.frameQueue.push(emu.getFrameBuffer());
@@ -174,9 +174,9 @@ const EmuScreen: React.FC<IEmuScreenProps> = (props) => {
         if (emu.getRunEmulation() && (window.frameQueue.length <= 3)) {
             console.log("calling");
             while (!emu.getFrameComplete()) {
-                const sample = emu.emulateSample();
-                speakers.writeSample(sample);
-                // samplesProvided++;
+                const nsamples = emu.runFrame();
+                speakers.writeSamples(emu.getAudioBuffer(), nsamples);
+                // samplesProvided += nsamples;
             }
             emu.clearFrameComplete();
             window.frameQueue.push(emu.getFrameBuffer());
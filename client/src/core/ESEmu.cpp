@@ -15,6 +15,8 @@
  */
 #include "ESEmu.h"
 
+#include <algorithm>
+
 #include <emscripten/bind.h>
 
 // FIXME: REPLACE WITH UTIL LOGGING
@@ -23,16 +25,23 @@
 #include "emu-core/PPU.h"
 
 namespace NESCLE {
+// Canvas ImageData wants RGBA bytes, so that is what we draw by default
+ESEmu::ESEmu() {
+    frame_buffer.fill(0);
+    audio_ring_enabled = false;
+    SetPixelFormat((int)PPU::PixelFormat::RGBA8888);
+}
+
+// View straight over the PPU's output, so there is nothing to convert
 emscripten::val ESEmu::GetFrameBuffer() {
-    constexpr int size = 256 * 240 * 4;
-    uint32_t* frame_buffer = nes.GetPPU().GetFramebuffer();
-    for (int i = 0; i < size; i += 4) {
-        frame_buffer_fixed[i+0] = (frame_buffer[i/4] & 0x00ff0000) >> 16;
-        frame_buffer_fixed[i+1] = (frame_buffer[i/4] & 0x0000ff00) >> 8;
-        frame_buffer_fixed[i+2] = frame_buffer[i/4] & 0x000000ff;
-        frame_buffer_fixed[i+3] = (frame_buffer[i/4] & 0xff000000) >> 24;
-    }
-    return emscripten::val(emscripten::typed_memory_view(size, frame_buffer_fixed));
+    size_t size = PPU::RESOLUTION_X * PPU::RESOLUTION_Y
+        * PPU::GetPixelSize(pixel_format);
+    return emscripten::val(emscripten::typed_memory_view(size, frame_buffer.data()));
+}
+
+void ESEmu::SetPixelFormat(int format) {
+    pixel_format = (PPU::PixelFormat)format;
+    nes.GetPPU().SetOutput(frame_buffer.data(), pixel_format);
 }
 
 bool ESEmu::LoadROM(uintptr_t buf_as_ptr) {
@@ -42,7 +51,7 @@ bool ESEmu::LoadROM(uintptr_t buf_as_ptr) {
 void ESEmu::Clock() {
     if (run_emulation) {
         while (!nes.GetPPU().GetFrameComplete()) {
-            nes.Clock();
+            nes.Run();
         }
         nes.GetPPU().ClearFrameComplete();
         // for (int i = 0; i < 500; i++) {
@@ -57,17 +66,54 @@ void ESEmu::Clock() {
 }
 
 float ESEmu::EmulateSample() {
-    while (!nes.Clock()) {
-    }
+    float sample = 0.0f;
+    size_t n = nes.RunSamples(&sample, 1);
+    if (audio_ring_enabled)
+        audio_ring.Write(&sample, n);
+    return sample;
+}
 
-    auto apu = nes.GetAPU();
-    float p1 = apu.GetPulse1Sample();
-    float p2 = apu.GetPulse2Sample();
-    float tri = apu.GetTriangleSample();
-    float noise = apu.GetNoiseSample();
-    float dmc = apu.GetSampleSample();
+// Runs until the frame is complete or the audio buffer is full. Unlike Clock,
+// the frame complete flag is left for the caller to clear. Returns how many
+// samples were written to the audio buffer
+int ESEmu::RunFrame() {
+    size_t n = nes.RunFrame(audio_buffer.data(), audio_buffer.size());
+    if (audio_ring_enabled)
+        audio_ring.Write(audio_buffer.data(), n);
+    return (int)n;
+}
 
-    return 0.20f * (p1 + p2 + tri + noise + dmc) * 0.5f;
+int ESEmu::RunUntilSamples(int nsamples) {
+    size_t n = std::min((size_t)std::max(nsamples, 0), audio_buffer.size());
+    n = nes.RunSamples(audio_buffer.data(), n);
+    if (audio_ring_enabled)
+        audio_ring.Write(audio_buffer.data(), n);
+    return (int)n;
+}
+
+// View over the audio buffer, only valid until the next run call
+emscripten::val ESEmu::GetAudioBuffer() {
+    return emscripten::val(emscripten::typed_memory_view(audio_buffer.size(),
+        audio_buffer.data()));
+}
+
+// Leave it off unless something is consuming the ring, or every sample just
+// counts as an overrun
+void ESEmu::SetAudioRingEnabled(bool enabled) {
+    audio_ring_enabled = enabled;
+}
+
+// Views over the ring for the audio thread to consume from directly, see
+// AudioRing for the layout. They stay valid for as long as the emulator
+// does, but another thread can only see them if memory is shared
+emscripten::val ESEmu::GetAudioRingData() {
+    return emscripten::val(emscripten::typed_memory_view(AudioRing::CAPACITY,
+        audio_ring.GetData()));
+}
+
+emscripten::val ESEmu::GetAudioRingState() {
+    return emscripten::val(emscripten::typed_memory_view(
+        (size_t)AudioRing::STATE_SIZE, audio_ring.GetState()));
 }
 
 bool ESEmu::GetFrameComplete() {
@@ -149,6 +195,10 @@ bool ESEmu::KeyUp(std::string key_name) {
 void ESEmu::SetSampleFrequency(uint32_t sample_frequency) {
     nes.SetSampleFrequency(sample_frequency);
 }
+
+void ESEmu::SetAudioFrameRate(uint32_t frame_rate) {
+    nes.SetAudioFrameRate(frame_rate);
+}
 }
 
 using namespace emscripten;
@@ -157,6 +207,7 @@ EMSCRIPTEN_BINDINGS(Emulator) {
     class_<NESCLE::ESEmu>("ESEmu")
     .constructor<>()
     .function("getFrameBuffer", &NESCLE::ESEmu::GetFrameBuffer)
+    .function("setPixelFormat", &NESCLE::ESEmu::SetPixelFormat)
     .function("clock", &NESCLE::ESEmu::Clock)
     .function("loadROM", &NESCLE::ESEmu::LoadROM)
     .function("getRunEmulation", &NESCLE::ESEmu::GetRunEmulation)
@@ -167,9 +218,16 @@ EMSCRIPTEN_BINDINGS(Emulator) {
     .function("keyDown", &NESCLE::ESEmu::KeyDown)
     .function("keyUp", &NESCLE::ESEmu::KeyUp)
     .function("emulateSample", &NESCLE::ESEmu::EmulateSample)
+    .function("runFrame", &NESCLE::ESEmu::RunFrame)
+    .function("runUntilSamples", &NESCLE::ESEmu::RunUntilSamples)
+    .function("getAudioBuffer", &NESCLE::ESEmu::GetAudioBuffer)
+    .function("setAudioRingEnabled", &NESCLE::ESEmu::SetAudioRingEnabled)
+    .function("getAudioRingData", &NESCLE::ESEmu::GetAudioRingData)
+    .function("getAudioRingState", &NESCLE::ESEmu::GetAudioRingState)
     .function("getFrameComplete", &NESCLE::ESEmu::GetFrameComplete)
     .function("clearFrameComplete", &NESCLE::ESEmu::ClearFrameComplete)
-    .function("setSampleFrequency", &NESCLE::ESEmu::SetSampleFrequency);
+    .function("setSampleFrequency", &NESCLE::ESEmu::SetSampleFrequency)
+    .function("setAudioFrameRate", &NESCLE::ESEmu::SetAudioFrameRate);
 
     register_vector<uint8_t>("ByteArr");
 }
@@ -16,28 +16,52 @@
 #ifndef ES_EMU_H_
 #define ES_EMU_H_
 
+#include <array>
 #include <cstdint>
 #include <vector>
 #include <string>
 
 #include <emscripten/val.h>
 
+#include "emu-core/AudioRing.h"
 #include "emu-core/Bus.h"
 
 namespace NESCLE {
 class ESEmu {
 private:
+    // Enough for a frame of audio at any sample rate a browser will use
+    static constexpr size_t AUDIO_BUFFER_SIZE = 4096;
+
+    static constexpr size_t FRAME_BUFFER_SIZE =
+        PPU::RESOLUTION_X * PPU::RESOLUTION_Y * 4;
+
     Bus nes;
-    // FIXME: THIS IS NEVER FREED
-    uint8_t* frame_buffer_fixed = new uint8_t[256 * 240 * 4];
+    std::array<float, AUDIO_BUFFER_SIZE> audio_buffer;
+    // When enabled, every sample the run calls write is also queued here for
+    // an audio thread to play
+    AudioRing audio_ring;
+    bool audio_ring_enabled;
+    // The PPU draws straight into this, in pixel_format
+    alignas(uint32_t) std::array<uint8_t, FRAME_BUFFER_SIZE> frame_buffer;
+    PPU::PixelFormat pixel_format;
     bool run_emulation;
 
 public:
+    ESEmu();
+
     bool LoadROM(uintptr_t file_buf_ptr);
     void Clock();
     float EmulateSample();
+    int RunFrame();
+    int RunUntilSamples(int nsamples);
+
+    emscripten::val GetAudioBuffer();
+    void SetAudioRingEnabled(bool enabled);
+    emscripten::val GetAudioRingData();
+    emscripten::val GetAudioRingState();
 
     emscripten::val GetFrameBuffer();
+    void SetPixelFormat(int format);
 
     void PowerOn();
     void Reset();
@@ -54,6 +78,7 @@ public:
     bool KeyUp(std::string key_name);
 
     void SetSampleFrequency(uint32_t sample_frequency);
+    void SetAudioFrameRate(uint32_t frame_rate);
 };
 }
 #endif
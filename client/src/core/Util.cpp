@@ -16,6 +16,7 @@
 #include "Util.h"
 
 #include <errno.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -62,6 +63,27 @@ void Util_MemsetU32(uint32_t* ptr, uint32_t val, size_t nelem) {
         ptr[i] = val;
 }
 
+uint8_t Util_FlipBits(uint8_t x) {
+    // The trivial algorithm is to say if the ith position is set,
+    // then the (7 - i)th bit would be set in the result
+
+    // However, this is a rather clever algorithm from GeeksForGeeks
+    // https://www.geeksforgeeks.org/write-an-efficient-c-program-to-reverse-bits-of-a-number/
+    int count = 7;
+    uint8_t res = x;
+
+    x >>= 1;
+    while (x > 0) {
+        res <<= 1;
+        res |= x & 1;
+        x >>= 1;
+        count--;
+    }
+
+    res <<= count;
+    return res;
+}
+
 #ifndef EMSCRIPTEN
 const char* Util_GetFileName(const char* path) {
     if (path == NULL)
@@ -82,9 +104,15 @@ const char* Util_GetFileName(const char* path) {
 
 bool Util_FileExists(const char* path) {
     FILE* file;
+    #ifdef UTIL_WINDOWS
     errno_t res = fopen_s(&file, path, "r");
     if (res != 0)
         return false;
+    #else
+    file = fopen(path, "r");
+    if (file == NULL)
+        return false;
+    #endif
     fclose(file);
     return true;
 }
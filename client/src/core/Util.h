@@ -57,6 +57,7 @@ bool Util_FileExists(const char* path);
 #endif // EMSCRIPTEN
 
 void Util_MemsetU32(uint32_t* ptr, uint32_t val, size_t nelem);
+uint8_t Util_FlipBits(uint8_t x);
 bool Util_FloatEquals(float a, float b);
 
 template<typename T>
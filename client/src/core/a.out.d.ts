@@ -8,11 +8,19 @@ export interface ESEmu {
   getFrameComplete(): boolean;
   setPC(_0: number): void;
   setSampleFrequency(_0: number): void;
+  setAudioFrameRate(_0: number): void;
   loadROM(_0: number): boolean;
   emulateSample(): number;
+  runFrame(): number;
+  runUntilSamples(_0: number): number;
+  getAudioBuffer(): any;
+  setAudioRingEnabled(_0: boolean): void;
+  getAudioRingData(): any;
+  getAudioRingState(): any;
   keyDown(_0: ArrayBuffer|Uint8Array|Uint8ClampedArray|Int8Array|string): boolean;
   keyUp(_0: ArrayBuffer|Uint8Array|Uint8ClampedArray|Int8Array|string): boolean;
   getFrameBuffer(): any;
+  setPixelFormat(_0: number): void;
   delete(): void;
 }
 
@@ -16,7 +16,9 @@
 // FIXME: THERE IS AN ISSUE WITH THE NOISE CHANNEL. LISTEN TO SMB
 #include "APU.h"
 
+#include <algorithm>
 #include <cassert>
+#include <climits>
 #include <cstring>
 
 #include "Bus.h"
@@ -161,11 +163,11 @@ bool APU::Write(uint16_t addr, uint8_t data) {
         sample.freq_counter_reset = sample.freq_counter;
         break;
     case 0x4011:
-        // Samples can use full range of the audio, so we
-        // divide by 127 here
-        sample.sample = 1.0f/127.0f * (data & 0x7f);
-        sample.dmc_delta = data & 0x7e;
+        // The DMC counts in steps of 2, the bottom bit only comes from here
+        sample.sample = data & 0x7f;
+        sample.dmc_delta = (data & 0x7e) >> 1;
         sample.dmc_lsb = data & 1;
+        UpdateLevel();
         break;
     case 0x4012:
         sample.addr = 0xc000 + (data << 6);
@@ -254,6 +256,21 @@ void APU::ClockSweeper(PulseChannel& pulse) {
     sweeper.mute = (sequencer.reload < 8) || (sequencer.reload > 0x7ff);
 }
 
+// Whether the channel's timer is counting, otherwise its output is held
+bool APU::IsPulseRunning(const PulseChannel& pulse) {
+    return pulse.enable && pulse.length > 0 && !pulse.sweeper.mute
+        && pulse.sequencer.reload > 7 && pulse.sequencer.reload < 0x7ff;
+}
+
+bool APU::IsNoiseRunning() {
+    return noise.enable && noise.length > 0 && noise.sequencer.reload > 7;
+}
+
+bool APU::IsTriangleRunning() {
+    return triangle.linear_counter > 0 && triangle.length > 0 && triangle.enable
+        && triangle.sequencer.reload > 1;
+}
+
 void APU::ClockPulse(PulseChannel& pulse) {
     // it is the job of the sweeper mute to handle the lo and hi pass
     // filtering
@@ -266,14 +283,13 @@ void APU::ClockPulse(PulseChannel& pulse) {
     // LIKE OLC
     // NAH MM2 IS STILL WEIRD, HAVE TO INVESTIGATE IT AS IT IS WELL KNOWN
     // TO BE WEIRD
-    if (pulse.enable && pulse.length > 0 && !pulse.sweeper.mute
-        && pulse.sequencer.reload > 7 && pulse.sequencer.reload < 0x7ff) {
+    if (IsPulseRunning(pulse)) {
         pulse.sequencer.timer--;
         if (pulse.sequencer.timer < 0) {
             pulse.sequencer.timer = pulse.sequencer.reload;
             pulse.duty_index = (pulse.duty_index + 1) % 8;
             int duty = GetDuty(pulse.duty_sequence, pulse.duty_index);
-            pulse.sample = 1.0f/15.0f * (duty * pulse.envelope.output);
+            pulse.sample = duty * pulse.envelope.output;
         }
     } else {
         pulse.sample = 0;
@@ -282,7 +298,7 @@ void APU::ClockPulse(PulseChannel& pulse) {
 
 void APU::ClockNoise() {
     auto pulse = &noise;
-    if (pulse->enable && pulse->length > 0 && pulse->sequencer.reload > 7) {
+    if (IsNoiseRunning()) {
         pulse->sequencer.timer--;
         if (pulse->sequencer.timer < 0) {
             pulse->sequencer.timer = pulse->sequencer.reload;
@@ -292,7 +308,7 @@ void APU::ClockNoise() {
             pulse->shift_register >>= 1;
             pulse->shift_register |= feedback << 14;
             int on = !(pulse->shift_register & 1);
-            pulse->sample = 1.0f/15.0f * (on * pulse->envelope.output);
+            pulse->sample = on * pulse->envelope.output;
             pulse->prev_sample = pulse->sample;
         }
     }
@@ -303,16 +319,14 @@ void APU::ClockNoise() {
 }
 
 void APU::ClockTriangle() {
-    if (triangle.linear_counter > 0 && triangle.length > 0 && triangle.enable
-        && triangle.sequencer.reload > 1) {
+    if (IsTriangleRunning()) {
         // Clock the sequencer
         triangle.sequencer.timer--;
         if (triangle.sequencer.timer < 0)
         {
             triangle.sequencer.timer = triangle.sequencer.reload;
             triangle.index = (triangle.index + 1) % 32;
-            int output = GetAmp(triangle.index);
-            triangle.sample = 1.0f/15.0f * output;
+            triangle.sample = GetAmp(triangle.index);
             triangle.prev_sample = triangle.sample;
         }
     } else {
@@ -404,12 +418,85 @@ void APU::Clock() {
     // The triangle wave clocks at the rate of the CPU
     if (clock_count % 3 == 0) {
         ClockTriangle();
+        UpdateLevel();
     }
 
     clock_count++;
 
 }
 
+// The next clock, from clock_count on, where Clock does more than count
+// down timers: a channel timer runs out, the frame sequencer steps, or a
+// stopped channel still has to drop its output
+uint64_t APU::GetNextClock() {
+    static constexpr int frame_steps[4] = {3729, 7457, 11186, 14916};
+
+    // APU cycles from the next one, the frame counter is bumped before it
+    // is checked
+    int cycles = 0;
+    for (int step : frame_steps) {
+        if (step > (int)frame_clock_count) {
+            cycles = step - (int)frame_clock_count - 1;
+            break;
+        }
+    }
+
+    for (PulseChannel* pulse : {&pulse1, &pulse2}) {
+        if (IsPulseRunning(*pulse))
+            cycles = std::min(cycles, std::max(pulse->sequencer.timer, 0));
+        else if (pulse->sample != 0)
+            cycles = 0;
+    }
+    if (IsNoiseRunning())
+        cycles = std::min(cycles, std::max(noise.sequencer.timer, 0));
+    else if (noise.sample != noise.prev_sample)
+        cycles = 0;
+    if (sample.enable && sample.freq_counter_reset > 0)
+        cycles = std::min(cycles, std::max(sample.freq_counter - 1, 0));
+
+    // The triangle counts in CPU cycles
+    int cpu_cycles = INT_MAX;
+    if (IsTriangleRunning())
+        cpu_cycles = std::max(triangle.sequencer.timer, 0);
+    else if (triangle.sample != triangle.prev_sample)
+        cpu_cycles = 0;
+
+    uint64_t next = (clock_count + 5) / 6 * 6 + 6 * (uint64_t)cycles;
+    if (cpu_cycles != INT_MAX)
+        next = std::min(next, (clock_count + 2) / 3 * 3 + 3 * (uint64_t)cpu_cycles);
+    return next;
+}
+
+// Counts the timers down for the clocks up to end, which GetNextClock says
+// have nothing else to do
+void APU::Skip(uint64_t end) {
+    int cycles = (int)((end + 5) / 6 - (clock_count + 5) / 6);
+    int cpu_cycles = (int)((end + 2) / 3 - (clock_count + 2) / 3);
+
+    frame_clock_count += cycles;
+    if (IsPulseRunning(pulse1))
+        pulse1.sequencer.timer -= cycles;
+    if (IsPulseRunning(pulse2))
+        pulse2.sequencer.timer -= cycles;
+    if (IsNoiseRunning())
+        noise.sequencer.timer -= cycles;
+    if (sample.enable)
+        sample.freq_counter -= cycles;
+    if (IsTriangleRunning())
+        triangle.sequencer.timer -= cpu_cycles;
+
+    clock_count = end;
+}
+
+void APU::Run(uint64_t end) {
+    while (clock_count < end) {
+        uint64_t next = std::min(GetNextClock(), end);
+        Skip(next);
+        if (next < end)
+            Clock();
+    }
+}
+
 int APU::GetDMAFreq(uint8_t index) {
     // FIXME: THIS IS DIFFERETN FOR PAL
     // This table uses CPU cycles and since we clock on every other CPU
@@ -440,7 +527,7 @@ void APU::ClockSample() {
                         sample.dmc_delta--;
                 }
 
-                sample.sample = 1.0f/127.0f * ((sample.dmc_delta << 1) | sample.dmc_lsb);
+                sample.sample = (sample.dmc_delta << 1) | sample.dmc_lsb;
                 sample.dmc_shifter >>= 1;
             }
 
@@ -525,12 +612,75 @@ void APU::Reset() {
     clock_count = 0;
     frame_clock_count = 0;
 
+    blip.Clear();
+    blip_level = 0;
+    audio_clock = 0;
+
     // sample.volume = 1.0f;
 }
 
-float APU::GetPulse1Sample() { return pulse1.sample; }
-float APU::GetPulse2Sample() { return pulse2.sample; }
-float APU::GetTriangleSample() { return triangle.sample; }
-float APU::GetNoiseSample() { return noise.sample; }
-float APU::GetSampleSample() { return sample.sample; }
+float APU::GetPulse1Sample() { return 1.0f/15.0f * pulse1.sample; }
+float APU::GetPulse2Sample() { return 1.0f/15.0f * pulse2.sample; }
+float APU::GetTriangleSample() { return 1.0f/15.0f * triangle.sample; }
+float APU::GetNoiseSample() { return 1.0f/15.0f * noise.sample; }
+float APU::GetSampleSample() { return 1.0f/127.0f * sample.sample; }
+
+// https://www.nesdev.org/wiki/APU_Mixer
+// The pulse channels share one resistor network and the other three share
+// another, so each group is looked up by its summed (weighted) level
+float APU::Mix(int pulse1, int pulse2, int triangle, int noise, int dmc) {
+    struct Tables {
+        float pulse[31];
+        float tnd[203];
+
+        Tables() {
+            pulse[0] = 0.0f;
+            for (int i = 1; i < 31; i++)
+                pulse[i] = (float)(95.52 / (8128.0 / i + 100.0));
+            tnd[0] = 0.0f;
+            for (int i = 1; i < 203; i++)
+                tnd[i] = (float)(163.67 / (24329.0 / i + 100.0));
+        }
+    };
+    static const Tables tables;
+
+    assert(pulse1 + pulse2 < 31 && 3 * triangle + 2 * noise + dmc < 203);
+    return tables.pulse[pulse1 + pulse2]
+        + tables.tnd[3 * triangle + 2 * noise + dmc];
+}
+
+float APU::GetMixedSample() {
+    return Mix(pulse1.sample, pulse2.sample, triangle.sample, noise.sample,
+        sample.sample);
+}
+
+// Records a step if the mixed output moved since the last one
+void APU::UpdateLevel() {
+    int level = (int)(GetMixedSample() * BlipBuffer::AMP_UNIT);
+    if (level != blip_level) {
+        blip.AddDelta(2 * (uint32_t)(clock_count - audio_clock), level - blip_level);
+        blip_level = level;
+    }
+}
+
+void APU::SetSampleRate(uint32_t half_clock_rate, uint32_t sample_rate) {
+    blip.SetRates(half_clock_rate, sample_rate);
+    audio_clock = clock_count;
+}
+
+void APU::EndFrame() {
+    blip.EndFrame(2 * (uint32_t)(clock_count - audio_clock));
+    audio_clock = clock_count;
+}
+
+// How many more clocks it takes before EndFrame makes nsamples available
+uint64_t APU::GetClocksNeeded(size_t nsamples) {
+    uint64_t needed = ((uint64_t)blip.GetClocksNeeded(nsamples) + 1) / 2;
+    uint64_t elapsed = clock_count - audio_clock;
+    return needed > elapsed ? needed - elapsed : 0;
+}
+
+size_t APU::ReadSamples(float* samples, size_t nsamples) {
+    return blip.ReadSamples(samples, nsamples);
+}
 }
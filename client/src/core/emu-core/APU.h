@@ -22,6 +22,7 @@
 #include <nlohmann/json.hpp>
 
 #include "../NESCLETypes.h"
+#include "BlipBuffer.h"
 
 namespace NESCLE {
 class APU {
@@ -62,9 +63,11 @@ private:
         int period;
     };
 
+    // Each channel's sample is the level it puts out on its DAC, 0-15 for
+    // the pulse, triangle and noise channels and 0-127 for the DMC
     struct PulseChannel {
         bool enable;
-        float sample;
+        uint8_t sample;
         bool halt;
         uint8_t length;
         float volume;
@@ -77,8 +80,8 @@ private:
 
     struct TriangleChannel {
         bool enable;
-        float sample;
-        float prev_sample;
+        uint8_t sample;
+        uint8_t prev_sample;
         int index;
         bool halt;
         uint8_t length;
@@ -94,8 +97,8 @@ private:
         bool enable;
         bool halt;
         uint8_t length;
-        float sample;
-        float prev_sample;
+        uint8_t sample;
+        uint8_t prev_sample;
         float volume;
         // FIXME: CHANGE TO INT BUT I'M AFRAID OF BREAKING THINGS
         uint16_t shift_register;
@@ -107,7 +110,7 @@ private:
 
     struct SampleChannel {
         bool enable;
-        float sample;
+        uint8_t sample;
         bool irq;
         bool loop;
         int freq_counter_reset;
@@ -128,6 +131,10 @@ private:
     uint8_t GetLength(int index);
     int GetDuty(int seq, int off);
 
+    bool IsPulseRunning(const PulseChannel& pulse);
+    bool IsNoiseRunning();
+    bool IsTriangleRunning();
+
     void ClockSweeper(PulseChannel& pulse);
     void ClockPulse(PulseChannel& pulse);
     void ClockNoise();
@@ -146,6 +153,16 @@ private:
     uint64_t clock_count;
     uint64_t frame_clock_count;
 
+    // The mixed output goes into blip as steps, timed from audio_clock, the
+    // clock the current audio frame started on
+    BlipBuffer blip;
+    int blip_level = 0;
+    uint64_t audio_clock = 0;
+
+    void UpdateLevel();
+
+    uint64_t GetNextClock();
+    void Skip(uint64_t end);
 
 public:
     static constexpr int SAMPLE_RATE = 44100;
@@ -159,12 +176,31 @@ public:
     bool Write(uint16_t addr, uint8_t data);
 
     void Clock();
+    // Same as calling Clock until the clock count reaches end, but the ticks
+    // where only the channel timers count down are skipped over
+    void Run(uint64_t end);
 
+    // Each channel's DAC level, scaled to 0-1
     float GetPulse1Sample();
     float GetPulse2Sample();
     float GetTriangleSample();
     float GetNoiseSample();
     float GetSampleSample();
+    // All five channels mixed down to the value the front end plays
+    float GetMixedSample();
+    // The NES's non-linear mixer, for DAC levels as described above. The
+    // output is between 0 and 1
+    static float Mix(int pulse1, int pulse2, int triangle, int noise, int dmc);
+
+    // Output samples, band limited from the mixed value. half_clock_rate is
+    // twice how often Clock is called per second of output, halves so that
+    // a NES frame can be a whole number of them. Samples up to the current
+    // clock are available once EndFrame is called
+    void SetSampleRate(uint32_t half_clock_rate, uint32_t sample_rate);
+    uint32_t GetSampleRate() { return blip.GetSampleRate(); }
+    void EndFrame();
+    uint64_t GetClocksNeeded(size_t nsamples);
+    size_t ReadSamples(float* samples, size_t nsamples);
 
     // Allows us to serialize the APU
     NLOHMANN_DEFINE_TYPE_INTRUSIVE(Sequencer, timer, reload)
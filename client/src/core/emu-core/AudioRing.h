@@ -0,0 +1,118 @@
+/*
+ * Copyright 2023 Edward C. Pinkston
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef AUDIORING_H_
+#define AUDIORING_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace NESCLE {
+/*
+ * Hands samples from the thread running the emulator to the thread playing
+ * them, without either one ever waiting on the other. Exactly one thread
+ * may Write and exactly one may Read.
+ *
+ * The positions are counts of every sample ever written and read, wrapping
+ * at 2^32, and only their owner stores to them. Everything lives inside the
+ * object, so a consumer in another language can read it straight out of
+ * memory: samples at GetData, and the positions and counters as 32 bit words
+ * at GetState, indexed by StateIndex. It loads WRITE_POS with acquire
+ * before reading samples and stores READ_POS with release after.
+ */
+class AudioRing {
+public:
+    // A power of two, so positions can wrap at 2^32 and still be masked
+    static constexpr size_t CAPACITY = 1 << 13;
+
+    // The producer's words and the consumer's words are a cache line apart
+    // so the two threads don't keep taking the line from each other
+    enum StateIndex : size_t {
+        WRITE_POS = 0,
+        OVERRUNS = 1,   // Samples dropped because the ring was full
+        READ_POS = 16,
+        UNDERRUNS = 17, // Samples played as silence because it was empty
+        STATE_SIZE = 32
+    };
+
+private:
+    static_assert(std::atomic<uint32_t>::is_always_lock_free);
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+
+    alignas(64) std::array<std::atomic<uint32_t>, STATE_SIZE> state{};
+    alignas(64) std::array<float, CAPACITY> samples{};
+
+    uint32_t Load(StateIndex idx, std::memory_order order = std::memory_order_relaxed) const {
+        return state[idx].load(order);
+    }
+
+public:
+    /* Producer */
+    // Copies in as many samples as there is room for and returns how many.
+    // The rest are counted as overruns
+    size_t Write(const float* data, size_t nsamples) {
+        uint32_t write_pos = Load(WRITE_POS);
+        size_t free = CAPACITY - (write_pos - Load(READ_POS, std::memory_order_acquire));
+        size_t n = std::min(nsamples, free);
+
+        size_t idx = write_pos % CAPACITY;
+        size_t first = std::min(n, CAPACITY - idx);
+        std::copy(data, data + first, samples.begin() + idx);
+        std::copy(data + first, data + n, samples.begin());
+
+        state[WRITE_POS].store(write_pos + (uint32_t)n, std::memory_order_release);
+        if (n < nsamples)
+            state[OVERRUNS].store(Load(OVERRUNS) + (uint32_t)(nsamples - n), std::memory_order_relaxed);
+        return n;
+    }
+    size_t GetFree() const {
+        return CAPACITY - (Load(WRITE_POS) - Load(READ_POS, std::memory_order_acquire));
+    }
+
+    /* Consumer */
+    // Fills all nsamples, with silence past what was available, and returns
+    // how many were real samples. The silence is counted as underruns
+    size_t Read(float* data, size_t nsamples) {
+        uint32_t read_pos = Load(READ_POS);
+        size_t avail = Load(WRITE_POS, std::memory_order_acquire) - read_pos;
+        size_t n = std::min(nsamples, avail);
+
+        size_t idx = read_pos % CAPACITY;
+        size_t first = std::min(n, CAPACITY - idx);
+        std::copy(samples.begin() + idx, samples.begin() + idx + first, data);
+        std::copy(samples.begin(), samples.begin() + (n - first), data + first);
+        std::fill(data + n, data + nsamples, 0.0f);
+
+        state[READ_POS].store(read_pos + (uint32_t)n, std::memory_order_release);
+        if (n < nsamples)
+            state[UNDERRUNS].store(Load(UNDERRUNS) + (uint32_t)(nsamples - n), std::memory_order_relaxed);
+        return n;
+    }
+    size_t GetAvail() const {
+        return Load(WRITE_POS, std::memory_order_acquire) - Load(READ_POS);
+    }
+
+    /* Either thread */
+    uint32_t GetOverruns() const { return Load(OVERRUNS); }
+    uint32_t GetUnderruns() const { return Load(UNDERRUNS); }
+
+    float* GetData() { return samples.data(); }
+    uint32_t* GetState() { return reinterpret_cast<uint32_t*>(state.data()); }
+};
+}
+#endif // AUDIORING_H_
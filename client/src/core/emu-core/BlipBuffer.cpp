@@ -0,0 +1,173 @@
+/*
+ * Copyright 2023 Edward C. Pinkston
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "BlipBuffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+namespace NESCLE {
+// Blackman windowed sinc, cut off a little under half the sample rate so
+// the window's roll off is done by the time it gets there
+const BlipBuffer::Kernel& BlipBuffer::GetKernel() {
+    alignas(32) static Kernel kernel;
+    static bool init = false;
+    if (init)
+        return kernel;
+
+    constexpr double PI = 3.14159265358979323846;
+    constexpr double CUTOFF = 0.45;
+    for (int phase = 0; phase < KERNEL_PHASES; phase++) {
+        // Middle of the range of offsets that end up with this phase
+        double frac = (phase + 0.5) / KERNEL_PHASES;
+        double taps[KERNEL_WIDTH];
+        double total = 0.0;
+        for (int i = 0; i < KERNEL_WIDTH; i++) {
+            double x = i - (KERNEL_WIDTH / 2 - 1) - frac;
+            double y = 2.0 * CUTOFF * x;
+            double sinc = y == 0.0 ? 1.0 : sin(PI * y) / (PI * y);
+            double window = 0.42 + 0.5 * cos(2.0 * PI * x / KERNEL_WIDTH)
+                + 0.08 * cos(4.0 * PI * x / KERNEL_WIDTH);
+            taps[i] = sinc * window;
+            total += taps[i];
+        }
+
+        // Rounding leaves the phase a little off KERNEL_UNIT, which goes on
+        // the biggest tap where it matters least
+        int sum = 0;
+        int peak = 0;
+        for (int i = 0; i < KERNEL_WIDTH; i++) {
+            kernel[phase][i] = (int32_t)lround(taps[i] / total * KERNEL_UNIT);
+            sum += kernel[phase][i];
+            if (kernel[phase][i] > kernel[phase][peak])
+                peak = i;
+        }
+        kernel[phase][peak] += KERNEL_UNIT - sum;
+    }
+
+    init = true;
+    return kernel;
+}
+
+void BlipBuffer::SetRates(uint32_t _clock_rate, uint32_t _sample_rate) {
+    clock_rate = _clock_rate;
+    sample_rate = _sample_rate;
+    // A quarter of a second, EndFrame throws away anything past the first
+    // half of that so there is always room for the next frame
+    buf.assign(sample_rate / 4 + KERNEL_WIDTH + 1, 0);
+    GetKernel();
+    Clear();
+}
+
+void BlipBuffer::Clear() {
+    std::fill(buf.begin(), buf.end(), 0);
+    offset = 0;
+    used = 0;
+    sum = 0;
+}
+
+void BlipBuffer::AddDelta(uint32_t time, int delta) {
+    if (sample_rate == 0 || delta == 0)
+        return;
+
+    uint64_t pos = offset + (uint64_t)time * sample_rate;
+    size_t idx = (size_t)(pos / clock_rate);
+    int phase = (int)(pos % clock_rate * KERNEL_PHASES / clock_rate);
+    assert(idx + KERNEL_WIDTH <= buf.size());
+
+    const int32_t* taps = GetKernel()[phase];
+    int32_t* out = &buf[idx];
+#if defined(__AVX2__)
+    __m256i scale = _mm256_set1_epi32(delta);
+    for (int i = 0; i < KERNEL_WIDTH; i += 8) {
+        __m256i tap = _mm256_load_si256((const __m256i*)(taps + i));
+        __m256i sum = _mm256_loadu_si256((const __m256i*)(out + i));
+        sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(tap, scale));
+        _mm256_storeu_si256((__m256i*)(out + i), sum);
+    }
+#elif defined(__SSE4_1__)
+    __m128i scale = _mm_set1_epi32(delta);
+    for (int i = 0; i < KERNEL_WIDTH; i += 4) {
+        __m128i tap = _mm_load_si128((const __m128i*)(taps + i));
+        __m128i sum = _mm_loadu_si128((const __m128i*)(out + i));
+        sum = _mm_add_epi32(sum, _mm_mullo_epi32(tap, scale));
+        _mm_storeu_si128((__m128i*)(out + i), sum);
+    }
+#elif defined(__wasm_simd128__)
+    v128_t scale = wasm_i32x4_splat(delta);
+    for (int i = 0; i < KERNEL_WIDTH; i += 4) {
+        v128_t sum = wasm_v128_load(out + i);
+        sum = wasm_i32x4_add(sum, wasm_i32x4_mul(wasm_v128_load(taps + i), scale));
+        wasm_v128_store(out + i, sum);
+    }
+#else
+    for (int i = 0; i < KERNEL_WIDTH; i++)
+        out[i] += delta * taps[i];
+#endif
+    used = std::max(used, idx + KERNEL_WIDTH);
+}
+
+void BlipBuffer::EndFrame(uint32_t time) {
+    if (sample_rate == 0)
+        return;
+
+    offset += (uint64_t)time * sample_rate;
+    // Nobody is reading, so the oldest samples make way
+    size_t max_avail = sample_rate / 8;
+    size_t avail = GetSamplesAvail();
+    if (avail > max_avail)
+        Read(nullptr, avail - max_avail);
+}
+
+uint32_t BlipBuffer::GetClocksNeeded(size_t nsamples) {
+    if (sample_rate == 0)
+        return 0;
+
+    uint64_t end = (GetSamplesAvail() + nsamples) * (uint64_t)clock_rate;
+    return (uint32_t)((end - offset + sample_rate - 1) / sample_rate);
+}
+
+size_t BlipBuffer::ReadSamples(float* samples, size_t nsamples) {
+    return Read(samples, std::min(nsamples, GetSamplesAvail()));
+}
+
+// Sums up nsamples, which must be available, and moves what is left of the
+// buffer down. samples can be null to just drop them
+size_t BlipBuffer::Read(float* samples, size_t nsamples) {
+    if (nsamples == 0)
+        return 0;
+
+    constexpr float SCALE = 1.0f / ((float)AMP_UNIT * KERNEL_UNIT);
+    for (size_t i = 0; i < nsamples; i++) {
+        sum += buf[i];
+        if (samples != nullptr)
+            samples[i] = sum * SCALE;
+    }
+
+    size_t end = std::max(used, nsamples);
+    std::copy(buf.begin() + nsamples, buf.begin() + end, buf.begin());
+    std::fill(buf.begin() + end - nsamples, buf.begin() + end, 0);
+    used = end - nsamples;
+    offset -= nsamples * (uint64_t)clock_rate;
+    return nsamples;
+}
+}
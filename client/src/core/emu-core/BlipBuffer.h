@@ -0,0 +1,87 @@
+/*
+ * Copyright 2023 Edward C. Pinkston
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BLIPBUFFER_H_
+#define BLIPBUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace NESCLE {
+/*
+ * Turns a signal that only changes in steps into samples at a lower rate
+ * without the aliasing you get from point sampling it. Each step is written
+ * as a band-limited step (the difference of a windowed sinc) at the time it
+ * happens, and reading the samples back sums up the differences.
+ *
+ * Times are in clocks from the start of the current frame. EndFrame makes
+ * every sample before the given time available to ReadSamples and starts a
+ * new frame there.
+ */
+class BlipBuffer {
+public:
+    // Amplitude that a sample of 1.0f comes out as
+    static constexpr int AMP_UNIT = 1 << 16;
+
+private:
+    // Each step is spread over KERNEL_WIDTH samples, at one of KERNEL_PHASES
+    // offsets between two samples. Every phase sums to exactly KERNEL_UNIT,
+    // so the integer sum never drifts away from the real level. The taps are
+    // kept as 32 bits so a phase can be added in with a few vector multiplies
+    static constexpr int KERNEL_WIDTH = 16;
+    static constexpr int KERNEL_PHASES = 32;
+    static constexpr int KERNEL_UNIT = 1 << 12;
+
+    using Kernel = int32_t[KERNEL_PHASES][KERNEL_WIDTH];
+    static const Kernel& GetKernel();
+
+    // sample_rate samples come out for every clock_rate clocks. The ratio is
+    // kept exactly, so which clock each sample falls on never drifts
+    uint32_t clock_rate = 0;
+    uint32_t sample_rate = 0;
+
+    // Where the current frame starts, in 1/clock_rate samples from buf[0].
+    // buf[0] is the first sample that hasn't been read yet
+    uint64_t offset = 0;
+    // Differences between each sample and the one before it
+    std::vector<int32_t> buf;
+    size_t used = 0;    // How far into buf steps have reached
+    // Level of the last sample read
+    int32_t sum = 0;
+
+    size_t Read(float* samples, size_t nsamples);
+
+public:
+    // A sample rate of 0 turns the buffer off, nothing gets recorded
+    void SetRates(uint32_t clock_rate, uint32_t sample_rate);
+    uint32_t GetSampleRate() { return sample_rate; }
+    void Clear();
+
+    // Steps the level by delta at time clocks into the current frame. A
+    // frame can't be longer than about an eighth of a second
+    void AddDelta(uint32_t time, int delta);
+    void EndFrame(uint32_t time);
+
+    size_t GetSamplesAvail() {
+        return clock_rate == 0 ? 0 : (size_t)(offset / clock_rate);
+    }
+    // How many clocks past the start of the frame it needs to end at for
+    // nsamples more to be available
+    uint32_t GetClocksNeeded(size_t nsamples);
+    size_t ReadSamples(float* samples, size_t nsamples);
+};
+}
+#endif // BLIPBUFFER_H_
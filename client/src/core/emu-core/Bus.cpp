@@ -17,11 +17,12 @@
 
 #include <algorithm>
 #include <cstring>
+#include <random>
 
 #include "APU.h"
 #include "CPU.h"
 #include "Cart.h"
-#include "mappers/Mapper.h"
+#include "mappers/MapperDispatch.h"
 #include "PPU.h"
 #include "../Util.h"
 
@@ -37,7 +38,19 @@ void Bus::ClearMemRand() {
     std::generate(std::begin(ram), std::end(ram), []() { return rand() % 256; });
 }
 
-uint8_t Bus::Read(uint16_t addr) {
+void Bus::ClearMemRand(uint32_t seed) {
+    // mt19937 is fully specified by the standard, so this gives the same
+    // RAM contents on every platform
+    std::mt19937 rng(seed);
+    std::generate(std::begin(ram), std::end(ram), [&rng]() { return rng() % 256; });
+}
+
+uint8_t Bus::DecodeRead(uint16_t addr) {
+    // Anything that isn't RAM or ROM may depend on the rest of the system
+    if (ahead_clock > clocks_count)
+        CatchUp();
+    cpu.ClearIdleLoop();
+
     // MARIO PAUSE BUG DISAS RELATED
     //if (addr == 0x0776 && bus->ram[addr] == 1)
         //printf("paused\n");
@@ -54,6 +67,7 @@ uint8_t Bus::Read(uint16_t addr) {
         return ppu.RegisterRead(addr);
     }
     else if ((addr >= 0x4000 && addr <= 0x4013) || addr == 0x4015) {
+        SyncAPU();
         return apu.Read(addr);
     }
     else if (addr == 0x4016 || addr == 0x4017) {
@@ -79,14 +93,19 @@ uint8_t Bus::Read(uint16_t addr) {
     }
     else if (addr >= 0x4020 && addr <= 0xffff) {
         /* Cartridge (REQUIRES MAPPER) */
-        return cart.GetMapper()->MapCPURead(addr);
+        return Mapper_Dispatch(*cart.GetMapper(), [addr](auto& mapper) {
+            return mapper.MapCPURead(addr);
+        });
     }
 
     // Return 0 on failed read
     return 0;
 }
 
-bool Bus::Write(uint16_t addr, uint8_t data) {
+bool Bus::DecodeWrite(uint16_t addr, uint8_t data) {
+    if (ahead_clock > clocks_count)
+        CatchUp();
+
     // MARIO PAUSE BUG DISAS RELATED
     //if (addr == 0x0776 && data == 1)
         //printf("pausing\n");
@@ -110,10 +129,26 @@ bool Bus::Write(uint16_t addr, uint8_t data) {
         dma_page = data;
         dma_addr = 0;
         dma_2003_off = ppu.RegisterRead(0x2003);
-        dma_transfer = true;
+
+        // The transfer starts on the next CPU cycle, and has a dummy cycle
+        // plus another if that one would be a write cycle, then 256 reads
+        // and writes. If the page reads have no side effects and the PPU
+        // won't look at OAM before the transfer ends, it is done in one go
+        // and the CPU is stalled for as long as it would have taken
+        const uint8_t* page = cpu_map.GetReadPage(dma_page << 8);
+        int ncycles = 513 + ((clocks_count + 3) % 2 == 0);
+        if (page != nullptr && 3 * ncycles <= ppu.GetOAMQuietTicks()) {
+            const uint8_t* src = page + (dma_page << 8) % CPUMemoryMap::PAGE_SIZE;
+            ppu.CopyOAM(src);
+            dma_data = src[0xff];
+            cpu.Stall(ncycles);
+        } else {
+            dma_transfer = true;
+        }
     } else if ((addr >= 0x4000 && addr <= 0x4013)
         || addr == 0x4015 || addr == 0x4017) {
         // FIXME: ADDRESS CONFLICT BETWEEN CONTROLLER 2 AND APU
+        SyncAPU();
         return apu.Write(addr, data);
     }
     else if (addr == 0x4016) {
@@ -129,7 +164,18 @@ bool Bus::Write(uint16_t addr, uint8_t data) {
     }
     else if (addr >= 0x4020 && addr <= 0xffff) {
         /* Cartridge */
-        return cart.GetMapper()->MapCPUWrite(addr, data);
+        // Mapper registers start at 0x8000 and may swap the CHR banks or
+        // mirroring out from under the line the PPU is drawing
+        if (addr >= 0x8000) {
+            ppu.SyncScanline();
+            SyncAPU();
+        }
+        return Mapper_Dispatch(*cart.GetMapper(), [this, addr, data](auto& mapper) {
+            bool written = mapper.MapCPUWrite(addr, data);
+            // Writes are how the mapper's IRQ gets acknowledged
+            cpu.SetInterrupt(CPU::INTERRUPT_IRQ, mapper.GetIRQStatus());
+            return written;
+        });
     }
 
     // Return false on failed read
@@ -145,70 +191,229 @@ bool Bus::Write16(uint16_t addr, uint16_t data) {
 }
 
 /* NES functions */
-bool Bus::Clock() {
-    // PPU runs 3x faster than the CPU
-    // FIXME: MAY WANNA REMOVE THE COUNTER BEING A LONG AND JUST HAVE IT RESET
-    //        EACH 3, SINCE LONG CAN OVERFLOW AND CAUSE ISSUES
-    ppu.Clock();
-    apu.Clock();
-
-    if (clocks_count % 3 == 0) {
-        // CPU completely halts if DMA is occuring
-        if (dma_transfer) {
-            // DMA takes some time, so we may have some dummy cycles
-            if (dma_dummy) {
-                // Sync on odd clock cycles
-                if (clocks_count % 2 == 1)
-                    dma_dummy = false;
-            }
-            else {
-                // Read on even cycles, write on odd cycles
-                if (clocks_count % 2 == 0) {
-                    dma_data = Read((dma_page << 8) | dma_addr);
-                } else {
-                    // DMA transfers 256 bytes to the OAM at once,
-                    // so we auto-increment the address
-                    // TODO: TRY PUTTING THE ++ IN THE FUNC CALL
-                    ppu.WriteOAM(dma_addr, dma_data);
-                    dma_addr++;
-
-                    // If we overflow, we know that the transfer is done
-                    if (dma_addr == 0) {
-                        dma_transfer = false;
-                        dma_dummy = true;
-                    }
-                }
-            }
+// Works out when each event is next due from the current state, since the
+// CPU or PPU may have been changed between runs
+void Bus::ScheduleEvents() {
+    scheduler.Clear();
+
+    // The CPU clocks on every third tick
+    cpu_clock = (clocks_count + 2) / 3 * 3;
+    ScheduleCPU();
+
+    // The PPU and mapper own the interrupt lines, the CPU only samples them
+    cpu.SetInterrupt(CPU::INTERRUPT_NMI, ppu.GetNMIStatus());
+    cpu.SetInterrupt(CPU::INTERRUPT_IRQ, cart.GetMapper()->GetIRQStatus());
+}
+
+void Bus::ScheduleCPU() {
+    // CPU completely halts if DMA is occuring, so each DMA cycle needs the bus
+    if (dma_transfer)
+        scheduler.Schedule(Scheduler::Event::CPU, cpu_clock);
+    else
+        scheduler.Schedule(Scheduler::Event::CPU,
+            cpu_clock + 3 * (uint64_t)cpu.GetCyclesRem());
+}
+
+// Applies the CPU ticks before end that were skipped over. These can only
+// be the CPU counting down the current instruction
+void Bus::SyncCPU(uint64_t end) {
+    if (dma_transfer || end <= cpu_clock)
+        return;
+
+    uint64_t ncycles = (end - cpu_clock + 2) / 3;
+    cpu.Skip((int)ncycles);
+    cpu_clock += 3 * ncycles;
+}
+
+void Bus::ClockCPU() {
+    SyncCPU(clocks_count);
+
+    if (dma_transfer)
+        ClockDMA();
+    else
+        cpu.Clock();
+
+    cpu_clock = clocks_count + 3;
+    if (cpu_idle_skip)
+        SkipIdleLoop();
+    ScheduleCPU();
+}
+
+void Bus::ClockDMA() {
+    // DMA takes some time, so we may have some dummy cycles
+    if (dma_dummy) {
+        // Sync on odd clock cycles
+        if (clocks_count % 2 == 1)
+            dma_dummy = false;
+    }
+    else {
+        // Read on even cycles, write on odd cycles
+        if (clocks_count % 2 == 0) {
+            dma_data = Read((dma_page << 8) | dma_addr);
         } else {
-            cpu.Clock();
+            // DMA transfers 256 bytes to the OAM at once,
+            // so we auto-increment the address
+            // TODO: TRY PUTTING THE ++ IN THE FUNC CALL
+            ppu.WriteOAM(dma_addr, dma_data);
+            dma_addr++;
+
+            // If we overflow, we know that the transfer is done
+            if (dma_addr == 0) {
+                dma_transfer = false;
+                dma_dummy = true;
+            }
         }
     }
+}
+
+// Lets the CPU go around the idle loop it just closed as many times as it
+// can before the PPU could interrupt it, without running any of the trips.
+// cpu_clock must already be set for the instruction that closed it
+void Bus::SkipIdleLoop() {
+    uint64_t period = 3 * (uint64_t)cpu.GetIdlePeriod();
+    if (period == 0 || cpu.GetInterrupts() != 0
+        || scheduler.GetTime(Scheduler::Event::NMI) != Scheduler::NEVER
+        || scheduler.GetTime(Scheduler::Event::IRQ) != Scheduler::NEVER)
+        return;
 
-    bool audio_ready = false;
-    audio_time += time_per_clock;
+    // The PPU can signal on the tick after its quiet ones, and the CPU goes
+    // first on that tick, so the CPU can still be fetching on it
+    uint64_t fetch = cpu_clock + 3 * (uint64_t)cpu.GetCyclesRem();
+    uint64_t limit = clocks_count + (uint64_t)ppu.GetQuietTicks() + 1;
+    if (fetch < limit)
+        cpu.SkipIdleLoop((limit - fetch) / period);
+}
+
+// Starts the instructions after the one on the current tick early, without
+// clocking the PPU up to them. That is safe as long as no other event is due
+// before them and the PPU can't signal one, since the CPU can't tell the
+// difference until it accesses the PPU or APU, and then CatchUp runs the PPU
+// up to the tick it is on. Must be called right after the CPU event
+// of the current tick
+void Bus::RunAhead(uint64_t until) {
+    // The PPU can signal on the tick limit itself, because the CPU goes
+    // first when events are due on the same tick
+    uint64_t limit = std::min(until - 1,
+        clocks_count + (uint64_t)ppu.GetQuietTicks() + 1);
 
-    // Enough time has elapsed to push an audio sample
-    // this should account for the extra time that we overshot by, although
-    // it may get less accurate over time due to floating point errors
-    if (audio_time >= time_per_sample) {
-        audio_time -= time_per_sample;
-        audio_ready = true;
+    while (!dma_transfer && scheduler.GetNext() == Scheduler::Event::CPU
+        && scheduler.GetNextTime() <= limit) {
+        ahead_clock = scheduler.GetNextTime();
+        SyncCPU(ahead_clock);
+        cpu.Clock();
+        cpu_clock = ahead_clock + 3;
+        if (cpu_idle_skip)
+            SkipIdleLoop();
+        ScheduleCPU();
     }
+    ahead_clock = 0;
+}
 
-    // PPU can optionally emit a NMI to the CPU upon entering the vertical
-    // blank state
-    if (ppu.GetNMIStatus()) {
-        ppu.ClearNMIStatus();
-        cpu.NMI();
+// Runs the PPU up to and including the tick the CPU is on
+void Bus::CatchUp() {
+    while (clocks_count < ahead_clock) {
+        clocks_count++;
+        ppu.Clock();
     }
+}
 
-    if (cart.GetMapper()->GetIRQStatus()) {
-        cart.GetMapper()->ClearIRQStatus();
-        cpu.IRQ();
+// The APU is only run when something needs to see its state, which is the
+// CPU touching it or swapping the banks the DMC reads from, and at the end
+// of a run. This runs it up to and including the current tick
+void Bus::SyncAPU() {
+    apu.Run(clocks_count + 1);
+}
+
+// Handles everything due on the current tick. Returns true if the run
+// should stop here, because the frame is done
+bool Bus::HandleEvents(uint64_t until) {
+    bool stop = false;
+
+    while (scheduler.GetNextTime() == clocks_count) {
+        switch (scheduler.GetNext()) {
+        case Scheduler::Event::CPU:
+            ClockCPU();
+            if (cpu_run_ahead)
+                RunAhead(until);
+            break;
+
+        case Scheduler::Event::NMI:
+            // PPU can optionally emit a NMI to the CPU upon entering the
+            // vertical blank state. The CPU goes first on a tick, so it
+            // sees the line from the next instruction it starts
+            scheduler.Cancel(Scheduler::Event::NMI);
+            cpu.SetInterrupt(CPU::INTERRUPT_NMI, true);
+            break;
+
+        case Scheduler::Event::IRQ:
+            scheduler.Cancel(Scheduler::Event::IRQ);
+            cpu.SetInterrupt(CPU::INTERRUPT_IRQ, true);
+            break;
+
+        case Scheduler::Event::FRAME:
+            scheduler.Cancel(Scheduler::Event::FRAME);
+            stop = true;
+            break;
+
+        default:
+            break;
+        }
     }
 
-    clocks_count++;
-    return audio_ready;
+    return stop;
+}
+
+// Runs ticks until one of them completes a frame, or until the clock
+// reaches until. Returns true if a frame was completed
+bool Bus::RunUntil(uint64_t until) {
+    ScheduleEvents();
+
+    bool stop = false;
+    while (!stop && clocks_count < until) {
+        // The PPU runs every tick, and tells us through Signal if it raised
+        // an NMI or IRQ or finished the frame
+        ppu.Clock();
+
+        if (clocks_count == scheduler.GetNextTime())
+            stop = HandleEvents(until);
+
+        clocks_count++;
+    }
+
+    // Leave the CPU and APU state as if every tick had been clocked, and
+    // make the audio up to here available
+    SyncCPU(clocks_count);
+    apu.Run(clocks_count);
+    apu.EndFrame();
+
+    return stop;
+}
+
+bool Bus::Clock() {
+    return RunUntil(clocks_count + 1);
+}
+
+bool Bus::Run() {
+    return RunUntil(Scheduler::NEVER);
+}
+
+size_t Bus::RunFrame(float* samples, size_t max_samples) {
+    while (!ppu.GetFrameComplete())
+        Run();
+    return apu.ReadSamples(samples, max_samples);
+}
+
+size_t Bus::RunSamples(float* samples, size_t nsamples) {
+    // Without a sample rate there won't ever be any
+    if (apu.GetSampleRate() == 0)
+        return 0;
+
+    size_t written = apu.ReadSamples(samples, nsamples);
+    while (written < nsamples) {
+        RunUntil(clocks_count + apu.GetClocksNeeded(nsamples - written));
+        written += apu.ReadSamples(samples + written, nsamples - written);
+    }
+    return written;
 }
 
 void Bus::PowerOn() {
@@ -229,10 +434,6 @@ void Bus::PowerOn() {
     dma_transfer = false;
     dma_dummy = true;
     clocks_count = 0;
-
-    time_per_sample = 0.0;
-    time_per_clock = 0.0;
-    audio_time = 0.0;
 }
 
 void Bus::Reset() {
@@ -253,7 +454,21 @@ void Bus::Reset() {
 }
 
 void Bus::SetSampleFrequency(uint32_t sample_frequency) {
-    time_per_sample = 1.0 / (double)sample_frequency;
-    time_per_clock = 1.0 / CLOCK_FREQ;
+    sample_rate = sample_frequency;
+    UpdateAudioRates();
+}
+
+void Bus::SetAudioFrameRate(uint32_t frame_rate) {
+    audio_frame_rate = frame_rate;
+    UpdateAudioRates();
+}
+
+// The APU's samples are spaced by an exact ratio of ticks, either the
+// system clock or a frame's worth of ticks for each frame in a second
+void Bus::UpdateAudioRates() {
+    uint32_t half_ticks = 2 * CLOCK_FREQ;
+    if (audio_frame_rate != 0)
+        half_ticks = HALF_TICKS_PER_FRAME * audio_frame_rate;
+    apu.SetSampleRate(half_ticks, sample_rate);
 }
 }
@@ -25,8 +25,10 @@
 #include "APU.h"
 #include "CPU.h"
 #include "Cart.h"
+#include "MemoryMap.h"
 #include "../NESCLETypes.h"
 #include "PPU.h"
+#include "Scheduler.h"
 
 namespace NESCLE {
 /*
@@ -38,10 +40,17 @@ namespace NESCLE {
 class Bus {
 private:
     static constexpr size_t RAM_SIZE = 1024 * 2;
-    static constexpr double CLOCK_FREQ = 5369318.0;
+    static constexpr uint32_t CLOCK_FREQ = 5369318;
+    // 341 dots by 262 lines, with a dot skipped on every other frame while
+    // rendering is on
+    static constexpr uint32_t HALF_TICKS_PER_FRAME = 2 * 341 * 262 - 1;
 
     std::array<uint8_t, RAM_SIZE> ram;
 
+    // RAM, PRG ROM and PRG RAM pages for Read/Write to go straight to. The
+    // mapper keeps the cartridge pages pointed at its current banks
+    CPUMemoryMap cpu_map;
+
     uint8_t controller1;
     uint8_t controller2;
     uint8_t controller1_shifter;
@@ -68,13 +77,47 @@ private:
     APU apu;
 
     // Audio info
-    double time_per_sample;
-    double time_per_clock;
-    double audio_time;
+    uint32_t sample_rate = 0;
+    uint32_t audio_frame_rate = 0;
 
     // How many system ticks have elapsed (PPU clocks at the same rate as the Bus)
     uint64_t clocks_count;
 
+    // Only valid while inside RunUntil. The CPU is not clocked on the ticks
+    // where it is just counting down an instruction, cpu_clock is the next
+    // CPU tick that hasn't been applied to it yet
+    Scheduler scheduler;
+    uint64_t cpu_clock;
+
+    // When set, the CPU starts instructions ahead of the PPU for as long as
+    // the PPU can't raise an event, and it is only caught up when the CPU
+    // touches something other than RAM or ROM. Otherwise both are stepped
+    // together one tick at a time
+    bool cpu_run_ahead = true;
+    // Tick of the instruction the CPU is running ahead on, 0 when it isn't
+    uint64_t ahead_clock = 0;
+
+    // When set, trips around a loop the CPU can't leave until it is
+    // interrupted are skipped, up to when the PPU could interrupt it
+    bool cpu_idle_skip = true;
+
+    void ScheduleEvents();
+    void ScheduleCPU();
+    void SyncCPU(uint64_t end);
+    void ClockCPU();
+    void ClockDMA();
+    bool HandleEvents(uint64_t until);
+    void SkipIdleLoop();
+    void RunAhead(uint64_t until);
+    void CatchUp();
+    void SyncAPU();
+    bool RunUntil(uint64_t until);
+    void UpdateAudioRates();
+
+    // Everything that isn't in cpu_map
+    uint8_t DecodeRead(uint16_t addr);
+    bool DecodeWrite(uint16_t addr, uint8_t data);
+
 public:
     enum class NESButtons : uint8_t {
         A = 0x1,
@@ -87,28 +130,66 @@ public:
         RIGHT = 0x80
     };
 
-    Bus() : cpu(*this), ppu(*this), apu(*this) {}
+    Bus() : cpu(*this), ppu(*this), cart(cpu_map, ppu), apu(*this) {
+        // The 2kb of RAM is mirrored all the way up to 0x2000
+        for (uint16_t addr = 0; addr < 0x2000; addr += RAM_SIZE)
+            cpu_map.Map(addr, RAM_SIZE, ram.data(), true);
+    }
 
     /* Read/Write */
     void ClearMem();        // Sets contents of RAM to a deterministic value
     void ClearMemRand();
-    uint8_t Read(uint16_t addr);
-    bool Write(uint16_t addr, uint8_t data);
+    void ClearMemRand(uint32_t seed);   // Reproducible garbage, for testing
+    uint8_t Read(uint16_t addr) {
+        const uint8_t* page = cpu_map.GetReadPage(addr);
+        if (page != nullptr)
+            return page[addr % CPUMemoryMap::PAGE_SIZE];
+        return DecodeRead(addr);
+    }
+    bool Write(uint16_t addr, uint8_t data) {
+        uint8_t* page = cpu_map.GetWritePage(addr);
+        if (page != nullptr) {
+            page[addr % CPUMemoryMap::PAGE_SIZE] = data;
+            return true;
+        }
+        return DecodeWrite(addr, data);
+    }
     uint16_t Read16(uint16_t addr);
     bool Write16(uint16_t addr, uint16_t data);
 
     /* NES functions */
+    // Both return true if the PPU finished a frame
     bool Clock();   // Tells the entire system to advance one tick
+    bool Run();     // Runs until a frame finishes
+
+    // Versions of Run that also write out the audio samples and return how
+    // many were written. RunFrame runs until the PPU finishes a frame and
+    // writes the frame's samples (as many as fit), RunSamples runs until
+    // nsamples are written. Samples that don't fit are kept for the next call
+    size_t RunFrame(float* samples, size_t max_samples);
+    size_t RunSamples(float* samples, size_t nsamples);
     void PowerOn(); // Sets entire system to powerup state
     void Reset();   // Equivalent to pushing the RESET button on a NES
 
     void SetSampleFrequency(uint32_t sample_rate);
+    // Stretches the audio so that frame_rate frames make up a second of it,
+    // so a front end that shows every frame at its own refresh rate gets as
+    // much audio as it plays. 0 goes back to the NES's own 60.1 frames
+    void SetAudioFrameRate(uint32_t frame_rate);
+    void SetCPURunAhead(bool run_ahead) { cpu_run_ahead = run_ahead; }
+    void SetCPUIdleSkip(bool idle_skip) { cpu_idle_skip = idle_skip; }
 
     // Getters and Setters
     APU& GetAPU() { return apu; }
     PPU& GetPPU() { return ppu; }
     CPU& GetCPU() { return cpu; }
     Cart& GetCart() { return cart; }
+    CPUMemoryMap& GetCPUMap() { return cpu_map; }
+
+    uint64_t GetClocksCount() { return clocks_count; }
+
+    // Lets a component report an event that happened on the current tick
+    void Signal(Scheduler::Event event) { scheduler.Schedule(event, clocks_count); }
 
     uint8_t GetController1() { return controller1; }
     void SetController1(uint8_t data) { controller1 = data; }
@@ -121,7 +202,7 @@ public:
     NLOHMANN_DEFINE_TYPE_INTRUSIVE(Bus, ram, controller1, controller2,
         controller1_shifter, controller2_shifter, dma_page, dma_addr, dma_data,
         dma_2003_off, dma_transfer, dma_dummy, cpu, ppu, cart, apu,
-        time_per_sample, time_per_clock, audio_time, clocks_count
+        clocks_count
     )
 };
 }
@@ -16,7 +16,6 @@
 #include "CPU.h"
 
 #include <cstdlib>
-#include <functional>
 #include <sstream>
 
 #include "Bus.h"
@@ -34,7 +33,7 @@ void to_json(nlohmann::json& j, const CPU& cpu) {
         {"y", cpu.y},
         {"x", cpu.x},
         {"sp", cpu.sp},
-        {"status", cpu.status},
+        {"status", cpu.GetStatus()},
         {"pc", cpu.pc},
 
         // HAVE TO STORE OPCODE SINCE INSTR* WILL BE INVALIDATED BETWEEN RUNS
@@ -51,7 +50,7 @@ void from_json(const nlohmann::json& j, CPU& cpu) {
     j.at("y").get_to(cpu.y);
     j.at("x").get_to(cpu.x);
     j.at("sp").get_to(cpu.sp);
-    j.at("status").get_to(cpu.status);
+    cpu.LoadStatus(j.at("status"));
     j.at("pc").get_to(cpu.pc);
 
     uint8_t opcode = j.at("opcode");
@@ -60,6 +59,8 @@ void from_json(const nlohmann::json& j, CPU& cpu) {
     j.at("addr_eff").get_to(cpu.addr_eff);
     j.at("cycles_rem").get_to(cpu.cycles_rem);
     j.at("cycles_count").get_to(cpu.cycles_count);
+    cpu.idle_pure = false;
+    cpu.idle_period = 0;
 }
 
 // Don't copy the reference to the bus
@@ -90,28 +91,86 @@ void from_json(const nlohmann::json& j, CPU& cpu) {
 // File used to log each CPU instruction
 FILE* nestest_log;
 
+// Defined constexpr so Exec can pick each opcode's handler at compile time
+constexpr CPU::Instr CPU::ISA[256] = {
+    {0X00, AddrMode::IMP, OpType::BRK, 1, 7}, {0X01, AddrMode::IDX, OpType::ORA, 2, 6}, {0X02, AddrMode::INV, OpType::INV, 1, 2}, {0X03, AddrMode::INV, OpType::INV, 1, 2}, {0X04, AddrMode::INV, OpType::INV, 1, 2}, {0x05, AddrMode::ZPG, OpType::ORA, 2, 3}, {0X06, AddrMode::ZPG, OpType::ASL, 2, 5}, {0X07, AddrMode::INV, OpType::INV, 1, 2}, {0X08, AddrMode::IMP, OpType::PHP, 1, 3}, {0X09, AddrMode::IMM, OpType::ORA, 2, 2}, {0X0A, AddrMode::ACC, OpType::ASL, 1, 2}, {0X0B, AddrMode::INV, OpType::INV, 1, 2}, {0X0C, AddrMode::INV, OpType::INV, 1, 2}, {0X0D, AddrMode::ABS, OpType::ORA, 3, 4}, {0X0E, AddrMode::ABS, OpType::ASL, 3, 6}, {0X0F, AddrMode::INV, OpType::INV, 1, 2},
+    {0X10, AddrMode::REL, OpType::BPL, 2, 2}, {0X11, AddrMode::IDY, OpType::ORA, 2, 5}, {0X12, AddrMode::INV, OpType::INV, 1, 2}, {0X13, AddrMode::INV, OpType::INV, 1, 2}, {0X14, AddrMode::INV, OpType::INV, 1, 2}, {0X15, AddrMode::ZPX, OpType::ORA, 2, 4}, {0X16, AddrMode::ZPX, OpType::ASL, 2, 6}, {0X17, AddrMode::INV, OpType::INV, 1, 2}, {0X18, AddrMode::IMP, OpType::CLC, 1, 2}, {0X19, AddrMode::ABY, OpType::ORA, 3, 4}, {0X1A, AddrMode::INV, OpType::INV, 1, 2}, {0X1B, AddrMode::INV, OpType::INV, 1, 2}, {0X1C, AddrMode::INV, OpType::INV, 1, 2}, {0x1D, AddrMode::ABX, OpType::ORA, 3, 4}, {0X1E, AddrMode::ABX, OpType::ASL, 3, 7}, {0X1F, AddrMode::INV, OpType::INV, 1, 2},
+    {0X20, AddrMode::ABS, OpType::JSR, 3, 6}, {0X21, AddrMode::IDX, OpType::AND, 2, 6}, {0X22, AddrMode::INV, OpType::INV, 1, 2}, {0X23, AddrMode::INV, OpType::INV, 1, 2}, {0X24, AddrMode::ZPG, OpType::BIT, 2, 3}, {0X25, AddrMode::ZPG, OpType::AND, 2, 3}, {0X26, AddrMode::ZPG, OpType::ROL, 2, 5}, {0X27, AddrMode::INV, OpType::INV, 1, 2}, {0X28, AddrMode::IMP, OpType::PLP, 1, 4}, {0X29, AddrMode::IMM, OpType::AND, 2, 2}, {0X2A, AddrMode::ACC, OpType::ROL, 1, 2}, {0X2B, AddrMode::INV, OpType::INV, 1, 2}, {0X2C, AddrMode::ABS, OpType::BIT, 3, 4}, {0X2D, AddrMode::ABS, OpType::AND, 3, 4}, {0X2E, AddrMode::ABS, OpType::ROL, 3, 6}, {0X2F, AddrMode::INV, OpType::INV, 1, 2},
+    {0X30, AddrMode::REL, OpType::BMI, 2, 2}, {0X31, AddrMode::IDY, OpType::AND, 2, 5}, {0X32, AddrMode::INV, OpType::INV, 1, 2}, {0X33, AddrMode::INV, OpType::INV, 1, 2}, {0X34, AddrMode::INV, OpType::INV, 1, 2}, {0X35, AddrMode::ZPX, OpType::AND, 2, 4}, {0X36, AddrMode::ZPX, OpType::ROL, 2, 6}, {0X37, AddrMode::INV, OpType::INV, 1, 2}, {0X38, AddrMode::IMP, OpType::SEC, 1, 2}, {0X39, AddrMode::ABY, OpType::AND, 3, 4}, {0X3A, AddrMode::INV, OpType::INV, 1, 2}, {0X3B, AddrMode::INV, OpType::INV, 1, 2}, {0X3C, AddrMode::INV, OpType::INV, 1, 2}, {0X3D, AddrMode::ABX, OpType::AND, 3, 4}, {0X3E, AddrMode::ABX, OpType::ROL, 3, 7}, {0X3F, AddrMode::INV, OpType::INV, 1, 2},
+    {0X40, AddrMode::IMP, OpType::RTI, 1, 6}, {0X41, AddrMode::IDX, OpType::EOR, 2, 6}, {0X42, AddrMode::INV, OpType::INV, 1, 2}, {0X43, AddrMode::INV, OpType::INV, 1, 2}, {0X44, AddrMode::INV, OpType::INV, 1, 2}, {0X45, AddrMode::ZPG, OpType::EOR, 2, 3}, {0X46, AddrMode::ZPG, OpType::LSR, 2, 5}, {0X47, AddrMode::INV, OpType::INV, 1, 2}, {0X48, AddrMode::IMP, OpType::PHA, 1, 3}, {0X49, AddrMode::IMM, OpType::EOR, 2, 2}, {0X4A, AddrMode::ACC, OpType::LSR, 1, 2}, {0X4B, AddrMode::INV, OpType::INV, 1, 2}, {0X4C, AddrMode::ABS, OpType::JMP, 3, 3}, {0X4D, AddrMode::ABS, OpType::EOR, 3, 4}, {0X4E, AddrMode::ABS, OpType::LSR, 3, 6}, {0X4F, AddrMode::INV, OpType::INV, 1, 2},
+    {0X50, AddrMode::REL, OpType::BVC, 2, 2}, {0X51, AddrMode::IDY, OpType::EOR, 2, 5}, {0X52, AddrMode::INV, OpType::INV, 1, 2}, {0X53, AddrMode::INV, OpType::INV, 1, 2}, {0X54, AddrMode::INV, OpType::INV, 1, 2}, {0X55, AddrMode::ZPX, OpType::EOR, 2, 4}, {0X56, AddrMode::ZPX, OpType::LSR, 2, 6}, {0X57, AddrMode::INV, OpType::INV, 1, 2}, {0X58, AddrMode::IMP, OpType::CLI, 1, 2}, {0X59, AddrMode::ABY, OpType::EOR, 3, 4}, {0X5A, AddrMode::INV, OpType::INV, 1, 2}, {0X5B, AddrMode::INV, OpType::INV, 1, 2}, {0X5C, AddrMode::INV, OpType::INV, 1, 2}, {0X5D, AddrMode::ABX, OpType::EOR, 3, 4}, {0X5E, AddrMode::ABX, OpType::LSR, 3, 7}, {0X5F, AddrMode::INV, OpType::INV, 1, 2},
+    {0X60, AddrMode::IMP, OpType::RTS, 1, 6}, {0X61, AddrMode::IDX, OpType::ADC, 2, 6}, {0X62, AddrMode::INV, OpType::INV, 1, 2}, {0X63, AddrMode::INV, OpType::INV, 1, 2}, {0X64, AddrMode::INV, OpType::INV, 1, 2}, {0X65, AddrMode::ZPG, OpType::ADC, 2, 3}, {0X66, AddrMode::ZPG, OpType::ROR, 2, 5}, {0X67, AddrMode::INV, OpType::INV, 1, 2}, {0X68, AddrMode::IMP, OpType::PLA, 1, 4}, {0X69, AddrMode::IMM, OpType::ADC, 2, 2}, {0X6A, AddrMode::ACC, OpType::ROR, 1, 2}, {0X6B, AddrMode::INV, OpType::INV, 1, 2}, {0X6C, AddrMode::IND, OpType::JMP, 3, 5}, {0X6D, AddrMode::ABS, OpType::ADC, 3, 4}, {0X6E, AddrMode::ABS, OpType::ROR, 3, 6}, {0X6F, AddrMode::INV, OpType::INV, 1, 2},
+    {0X70, AddrMode::REL, OpType::BVS, 2, 2}, {0X71, AddrMode::IDY, OpType::ADC, 2, 5}, {0X72, AddrMode::INV, OpType::INV, 1, 2}, {0X73, AddrMode::INV, OpType::INV, 1, 2}, {0X74, AddrMode::INV, OpType::INV, 1, 2}, {0X75, AddrMode::ZPX, OpType::ADC, 2, 4}, {0X76, AddrMode::ZPX, OpType::ROR, 2, 6}, {0X77, AddrMode::INV, OpType::INV, 1, 2}, {0X78, AddrMode::IMP, OpType::SEI, 1, 2}, {0X79, AddrMode::ABY, OpType::ADC, 3, 4}, {0X7A, AddrMode::INV, OpType::INV, 1, 2}, {0X7B, AddrMode::INV, OpType::INV, 1, 2}, {0X7C, AddrMode::INV, OpType::INV, 1, 2}, {0X7D, AddrMode::ABX, OpType::ADC, 3, 4}, {0X7E, AddrMode::ABX, OpType::ROR, 3, 7}, {0X7F, AddrMode::INV, OpType::INV, 1, 2},
+    {0X80, AddrMode::INV, OpType::INV, 1, 2}, {0X81, AddrMode::IDX, OpType::STA, 2, 6}, {0X82, AddrMode::INV, OpType::INV, 1, 2}, {0X83, AddrMode::INV, OpType::INV, 1, 2}, {0X84, AddrMode::ZPG, OpType::STY, 2, 3}, {0X85, AddrMode::ZPG, OpType::STA, 2, 3}, {0X86, AddrMode::ZPG, OpType::STX, 2, 3}, {0X87, AddrMode::INV, OpType::INV, 1, 2}, {0X88, AddrMode::IMP, OpType::DEY, 1, 2}, {0X89, AddrMode::INV, OpType::INV, 1, 2}, {0X8A, AddrMode::IMP, OpType::TXA, 1, 2}, {0X8B, AddrMode::INV, OpType::INV, 1, 2}, {0X8C, AddrMode::ABS, OpType::STY, 3, 4}, {0X8D, AddrMode::ABS, OpType::STA, 3, 4}, {0X8E, AddrMode::ABS, OpType::STX, 3, 4}, {0X8F, AddrMode::INV, OpType::INV, 1, 2},
+    {0X90, AddrMode::REL, OpType::BCC, 2, 2}, {0X91, AddrMode::IDY, OpType::STA, 2, 6}, {0X92, AddrMode::INV, OpType::INV, 1, 2}, {0X93, AddrMode::INV, OpType::INV, 1, 2}, {0X94, AddrMode::ZPX, OpType::STY, 2, 4}, {0X95, AddrMode::ZPX, OpType::STA, 2, 4}, {0X96, AddrMode::ZPY, OpType::STX, 2, 4}, {0X97, AddrMode::INV, OpType::INV, 1, 2}, {0X98, AddrMode::IMP, OpType::TYA, 1, 2}, {0X99, AddrMode::ABY, OpType::STA, 3, 5}, {0X9A, AddrMode::IMP, OpType::TXS, 1, 2}, {0X9B, AddrMode::INV, OpType::INV, 1, 2}, {0X9C, AddrMode::INV, OpType::INV, 1, 2}, {0X9D, AddrMode::ABX, OpType::STA, 3, 5}, {0X9E, AddrMode::INV, OpType::INV, 1, 2}, {0X9F, AddrMode::INV, OpType::INV, 1, 2},
+    {0XA0, AddrMode::IMM, OpType::LDY, 2, 2}, {0XA1, AddrMode::IDX, OpType::LDA, 2, 6}, {0XA2, AddrMode::IMM, OpType::LDX, 2, 2}, {0XA3, AddrMode::INV, OpType::INV, 1, 2}, {0XA4, AddrMode::ZPG, OpType::LDY, 2, 3}, {0XA5, AddrMode::ZPG, OpType::LDA, 2, 3}, {0XA6, AddrMode::ZPG, OpType::LDX, 2, 3}, {0XA7, AddrMode::INV, OpType::INV, 1, 2}, {0XA8, AddrMode::IMP, OpType::TAY, 1, 2}, {0XA9, AddrMode::IMM, OpType::LDA, 2, 2}, {0XAA, AddrMode::IMP, OpType::TAX, 1, 2}, {0XAB, AddrMode::INV, OpType::INV, 1, 2}, {0XAC, AddrMode::ABS, OpType::LDY, 3, 4}, {0XAD, AddrMode::ABS, OpType::LDA, 3, 4}, {0XAE, AddrMode::ABS, OpType::LDX, 3, 4}, {0XAF, AddrMode::INV, OpType::INV, 1, 2},
+    {0XB0, AddrMode::REL, OpType::BCS, 2, 2}, {0XB1, AddrMode::IDY, OpType::LDA, 2, 5}, {0XB2, AddrMode::INV, OpType::INV, 1, 2}, {0XB3, AddrMode::INV, OpType::INV, 1, 2}, {0XB4, AddrMode::ZPX, OpType::LDY, 2, 4}, {0XB5, AddrMode::ZPX, OpType::LDA, 2, 4}, {0XB6, AddrMode::ZPY, OpType::LDX, 2, 4}, {0XB7, AddrMode::INV, OpType::INV, 1, 2}, {0XB8, AddrMode::IMP, OpType::CLV, 1, 2}, {0XB9, AddrMode::ABY, OpType::LDA, 3, 4}, {0XBA, AddrMode::IMP, OpType::TSX, 1, 2}, {0XBB, AddrMode::INV, OpType::INV, 1, 2}, {0XBC, AddrMode::ABX, OpType::LDY, 3, 4}, {0XBD, AddrMode::ABX, OpType::LDA, 3, 4}, {0XBE, AddrMode::ABY, OpType::LDX, 3, 4}, {0XBF, AddrMode::INV, OpType::INV, 1, 2},
+    {0XC0, AddrMode::IMM, OpType::CPY, 2, 2}, {0XC1, AddrMode::IDX, OpType::CMP, 2, 6}, {0XC2, AddrMode::INV, OpType::INV, 1, 2}, {0XC3, AddrMode::INV, OpType::INV, 1, 2}, {0XC4, AddrMode::ZPG, OpType::CPY, 2, 3}, {0XC5, AddrMode::ZPG, OpType::CMP, 2, 3}, {0XC6, AddrMode::ZPG, OpType::DEC, 2, 5}, {0XC7, AddrMode::INV, OpType::INV, 1, 2}, {0XC8, AddrMode::IMP, OpType::INY, 1, 2}, {0XC9, AddrMode::IMM, OpType::CMP, 2, 2}, {0XCA, AddrMode::IMP, OpType::DEX, 1, 2}, {0XCB, AddrMode::INV, OpType::INV, 1, 2}, {0XCC, AddrMode::ABS, OpType::CPY, 3, 4}, {0XCD, AddrMode::ABS, OpType::CMP, 3, 4}, {0XCE, AddrMode::ABS, OpType::DEC, 3, 6}, {0XCF, AddrMode::INV, OpType::INV, 1, 2},
+    {0XD0, AddrMode::REL, OpType::BNE, 2, 2}, {0XD1, AddrMode::IDY, OpType::CMP, 2, 5}, {0XD2, AddrMode::INV, OpType::INV, 1, 2}, {0XD3, AddrMode::INV, OpType::INV, 1, 2}, {0XD4, AddrMode::INV, OpType::INV, 1, 2}, {0XD5, AddrMode::ZPX, OpType::CMP, 2, 4}, {0XD6, AddrMode::ZPX, OpType::DEC, 2, 6}, {0XD7, AddrMode::INV, OpType::INV, 1, 2}, {0XD8, AddrMode::IMP, OpType::CLD, 1, 2}, {0XD9, AddrMode::ABY, OpType::CMP, 3, 4}, {0XDA, AddrMode::INV, OpType::INV, 1, 2}, {0XDB, AddrMode::INV, OpType::INV, 1, 2}, {0XDC, AddrMode::INV, OpType::INV, 1, 2}, {0XDD, AddrMode::ABX, OpType::CMP, 3, 4}, {0XDE, AddrMode::ABX, OpType::DEC, 3, 7}, {0XDF, AddrMode::INV, OpType::INV, 1, 2},
+    {0XE0, AddrMode::IMM, OpType::CPX, 2, 2}, {0XE1, AddrMode::IDX, OpType::SBC, 2, 6}, {0XE2, AddrMode::INV, OpType::INV, 1, 2}, {0XE3, AddrMode::INV, OpType::INV, 1, 2}, {0XE4, AddrMode::ZPG, OpType::CPX, 2, 3}, {0XE5, AddrMode::ZPG, OpType::SBC, 2, 3}, {0XE6, AddrMode::ZPG, OpType::INC, 2, 5}, {0XE7, AddrMode::INV, OpType::INV, 1, 2}, {0XE8, AddrMode::IMP, OpType::INX, 1, 2}, {0XE9, AddrMode::IMM, OpType::SBC, 2, 2}, {0XEA, AddrMode::IMP, OpType::NOP, 1, 2}, {0XEB, AddrMode::INV, OpType::INV, 1, 2}, {0XEC, AddrMode::ABS, OpType::CPX, 3, 4}, {0XED, AddrMode::ABS, OpType::SBC, 3, 4}, {0XEE, AddrMode::ABS, OpType::INC, 3, 6}, {0XEF, AddrMode::INV, OpType::INV, 1, 2},
+    {0XF0, AddrMode::REL, OpType::BEQ, 2, 2}, {0XF1, AddrMode::IDY, OpType::SBC, 2, 5}, {0XF2, AddrMode::INV, OpType::INV, 1, 2}, {0XF3, AddrMode::INV, OpType::INV, 1, 2}, {0XF4, AddrMode::INV, OpType::INV, 1, 2}, {0XF5, AddrMode::ZPX, OpType::SBC, 2, 4}, {0XF6, AddrMode::ZPX, OpType::INC, 2, 6}, {0XF7, AddrMode::INV, OpType::INV, 1, 2}, {0XF8, AddrMode::IMP, OpType::SED, 1, 2}, {0XF9, AddrMode::ABY, OpType::SBC, 3, 4}, {0XFA, AddrMode::INV, OpType::INV, 1, 2}, {0XFB, AddrMode::INV, OpType::INV, 1, 2}, {0XFC, AddrMode::INV, OpType::INV, 1, 2}, {0XFD, AddrMode::ABX, OpType::SBC, 3, 4}, {0XFE, AddrMode::ABX, OpType::INC, 3, 7}, {0XFF, AddrMode::INV, OpType::INV, 1, 2}
+};
+
 const CPU::Instr* CPU::Decode(uint8_t opcode) {
-    // 6502 ISA indexed by opcode
-    static const Instr isa[256] = {
-        {0X00, AddrMode::IMP, OpType::BRK, 1, 7}, {0X01, AddrMode::IDX, OpType::ORA, 2, 6}, {0X02, AddrMode::INV, OpType::INV, 1, 2}, {0X03, AddrMode::INV, OpType::INV, 1, 2}, {0X04, AddrMode::INV, OpType::INV, 1, 2}, {0x05, AddrMode::ZPG, OpType::ORA, 2, 3}, {0X06, AddrMode::ZPG, OpType::ASL, 2, 5}, {0X07, AddrMode::INV, OpType::INV, 1, 2}, {0X08, AddrMode::IMP, OpType::PHP, 1, 3}, {0X09, AddrMode::IMM, OpType::ORA, 2, 2}, {0X0A, AddrMode::ACC, OpType::ASL, 1, 2}, {0X0B, AddrMode::INV, OpType::INV, 1, 2}, {0X0C, AddrMode::INV, OpType::INV, 1, 2}, {0X0D, AddrMode::ABS, OpType::ORA, 3, 4}, {0X0E, AddrMode::ABS, OpType::ASL, 3, 6}, {0X0F, AddrMode::INV, OpType::INV, 1, 2},
-        {0X10, AddrMode::REL, OpType::BPL, 2, 2}, {0X11, AddrMode::IDY, OpType::ORA, 2, 5}, {0X12, AddrMode::INV, OpType::INV, 1, 2}, {0X13, AddrMode::INV, OpType::INV, 1, 2}, {0X14, AddrMode::INV, OpType::INV, 1, 2}, {0X15, AddrMode::ZPX, OpType::ORA, 2, 4}, {0X16, AddrMode::ZPX, OpType::ASL, 2, 6}, {0X17, AddrMode::INV, OpType::INV, 1, 2}, {0X18, AddrMode::IMP, OpType::CLC, 1, 2}, {0X19, AddrMode::ABY, OpType::ORA, 3, 4}, {0X1A, AddrMode::INV, OpType::INV, 1, 2}, {0X1B, AddrMode::INV, OpType::INV, 1, 2}, {0X1C, AddrMode::INV, OpType::INV, 1, 2}, {0x1D, AddrMode::ABX, OpType::ORA, 3, 4}, {0X1E, AddrMode::ABX, OpType::ASL, 3, 7}, {0X1F, AddrMode::INV, OpType::INV, 1, 2},
-        {0X20, AddrMode::ABS, OpType::JSR, 3, 6}, {0X21, AddrMode::IDX, OpType::AND, 2, 6}, {0X22, AddrMode::INV, OpType::INV, 1, 2}, {0X23, AddrMode::INV, OpType::INV, 1, 2}, {0X24, AddrMode::ZPG, OpType::BIT, 2, 3}, {0X25, AddrMode::ZPG, OpType::AND, 2, 3}, {0X26, AddrMode::ZPG, OpType::ROL, 2, 5}, {0X27, AddrMode::INV, OpType::INV, 1, 2}, {0X28, AddrMode::IMP, OpType::PLP, 1, 4}, {0X29, AddrMode::IMM, OpType::AND, 2, 2}, {0X2A, AddrMode::ACC, OpType::ROL, 1, 2}, {0X2B, AddrMode::INV, OpType::INV, 1, 2}, {0X2C, AddrMode::ABS, OpType::BIT, 3, 4}, {0X2D, AddrMode::ABS, OpType::AND, 3, 4}, {0X2E, AddrMode::ABS, OpType::ROL, 3, 6}, {0X2F, AddrMode::INV, OpType::INV, 1, 2},
-        {0X30, AddrMode::REL, OpType::BMI, 2, 2}, {0X31, AddrMode::IDY, OpType::AND, 2, 5}, {0X32, AddrMode::INV, OpType::INV, 1, 2}, {0X33, AddrMode::INV, OpType::INV, 1, 2}, {0X34, AddrMode::INV, OpType::INV, 1, 2}, {0X35, AddrMode::ZPX, OpType::AND, 2, 4}, {0X36, AddrMode::ZPX, OpType::ROL, 2, 6}, {0X37, AddrMode::INV, OpType::INV, 1, 2}, {0X38, AddrMode::IMP, OpType::SEC, 1, 2}, {0X39, AddrMode::ABY, OpType::AND, 3, 4}, {0X3A, AddrMode::INV, OpType::INV, 1, 2}, {0X3B, AddrMode::INV, OpType::INV, 1, 2}, {0X3C, AddrMode::INV, OpType::INV, 1, 2}, {0X3D, AddrMode::ABX, OpType::AND, 3, 4}, {0X3E, AddrMode::ABX, OpType::ROL, 3, 7}, {0X3F, AddrMode::INV, OpType::INV, 1, 2},
-        {0X40, AddrMode::IMP, OpType::RTI, 1, 6}, {0X41, AddrMode::IDX, OpType::EOR, 2, 6}, {0X42, AddrMode::INV, OpType::INV, 1, 2}, {0X43, AddrMode::INV, OpType::INV, 1, 2}, {0X44, AddrMode::INV, OpType::INV, 1, 2}, {0X45, AddrMode::ZPG, OpType::EOR, 2, 3}, {0X46, AddrMode::ZPG, OpType::LSR, 2, 5}, {0X47, AddrMode::INV, OpType::INV, 1, 2}, {0X48, AddrMode::IMP, OpType::PHA, 1, 3}, {0X49, AddrMode::IMM, OpType::EOR, 2, 2}, {0X4A, AddrMode::ACC, OpType::LSR, 1, 2}, {0X4B, AddrMode::INV, OpType::INV, 1, 2}, {0X4C, AddrMode::ABS, OpType::JMP, 3, 3}, {0X4D, AddrMode::ABS, OpType::EOR, 3, 4}, {0X4E, AddrMode::ABS, OpType::LSR, 3, 6}, {0X4F, AddrMode::INV, OpType::INV, 1, 2},
-        {0X50, AddrMode::REL, OpType::BVC, 2, 2}, {0X51, AddrMode::IDY, OpType::EOR, 2, 5}, {0X52, AddrMode::INV, OpType::INV, 1, 2}, {0X53, AddrMode::INV, OpType::INV, 1, 2}, {0X54, AddrMode::INV, OpType::INV, 1, 2}, {0X55, AddrMode::ZPX, OpType::EOR, 2, 4}, {0X56, AddrMode::ZPX, OpType::LSR, 2, 6}, {0X57, AddrMode::INV, OpType::INV, 1, 2}, {0X58, AddrMode::IMP, OpType::CLI, 1, 2}, {0X59, AddrMode::ABY, OpType::EOR, 3, 4}, {0X5A, AddrMode::INV, OpType::INV, 1, 2}, {0X5B, AddrMode::INV, OpType::INV, 1, 2}, {0X5C, AddrMode::INV, OpType::INV, 1, 2}, {0X5D, AddrMode::ABX, OpType::EOR, 3, 4}, {0X5E, AddrMode::ABX, OpType::LSR, 3, 7}, {0X5F, AddrMode::INV, OpType::INV, 1, 2},
-        {0X60, AddrMode::IMP, OpType::RTS, 1, 6}, {0X61, AddrMode::IDX, OpType::ADC, 2, 6}, {0X62, AddrMode::INV, OpType::INV, 1, 2}, {0X63, AddrMode::INV, OpType::INV, 1, 2}, {0X64, AddrMode::INV, OpType::INV, 1, 2}, {0X65, AddrMode::ZPG, OpType::ADC, 2, 3}, {0X66, AddrMode::ZPG, OpType::ROR, 2, 5}, {0X67, AddrMode::INV, OpType::INV, 1, 2}, {0X68, AddrMode::IMP, OpType::PLA, 1, 4}, {0X69, AddrMode::IMM, OpType::ADC, 2, 2}, {0X6A, AddrMode::ACC, OpType::ROR, 1, 2}, {0X6B, AddrMode::INV, OpType::INV, 1, 2}, {0X6C, AddrMode::IND, OpType::JMP, 3, 5}, {0X6D, AddrMode::ABS, OpType::ADC, 3, 4}, {0X6E, AddrMode::ABS, OpType::ROR, 3, 6}, {0X6F, AddrMode::INV, OpType::INV, 1, 2},
-        {0X70, AddrMode::REL, OpType::BVS, 2, 2}, {0X71, AddrMode::IDY, OpType::ADC, 2, 5}, {0X72, AddrMode::INV, OpType::INV, 1, 2}, {0X73, AddrMode::INV, OpType::INV, 1, 2}, {0X74, AddrMode::INV, OpType::INV, 1, 2}, {0X75, AddrMode::ZPX, OpType::ADC, 2, 4}, {0X76, AddrMode::ZPX, OpType::ROR, 2, 6}, {0X77, AddrMode::INV, OpType::INV, 1, 2}, {0X78, AddrMode::IMP, OpType::SEI, 1, 2}, {0X79, AddrMode::ABY, OpType::ADC, 3, 4}, {0X7A, AddrMode::INV, OpType::INV, 1, 2}, {0X7B, AddrMode::INV, OpType::INV, 1, 2}, {0X7C, AddrMode::INV, OpType::INV, 1, 2}, {0X7D, AddrMode::ABX, OpType::ADC, 3, 4}, {0X7E, AddrMode::ABX, OpType::ROR, 3, 7}, {0X7F, AddrMode::INV, OpType::INV, 1, 2},
-        {0X80, AddrMode::INV, OpType::INV, 1, 2}, {0X81, AddrMode::IDX, OpType::STA, 2, 6}, {0X82, AddrMode::INV, OpType::INV, 1, 2}, {0X83, AddrMode::INV, OpType::INV, 1, 2}, {0X84, AddrMode::ZPG, OpType::STY, 2, 3}, {0X85, AddrMode::ZPG, OpType::STA, 2, 3}, {0X86, AddrMode::ZPG, OpType::STX, 2, 3}, {0X87, AddrMode::INV, OpType::INV, 1, 2}, {0X88, AddrMode::IMP, OpType::DEY, 1, 2}, {0X89, AddrMode::INV, OpType::INV, 1, 2}, {0X8A, AddrMode::IMP, OpType::TXA, 1, 2}, {0X8B, AddrMode::INV, OpType::INV, 1, 2}, {0X8C, AddrMode::ABS, OpType::STY, 3, 4}, {0X8D, AddrMode::ABS, OpType::STA, 3, 4}, {0X8E, AddrMode::ABS, OpType::STX, 3, 4}, {0X8F, AddrMode::INV, OpType::INV, 1, 2},
-        {0X90, AddrMode::REL, OpType::BCC, 2, 2}, {0X91, AddrMode::IDY, OpType::STA, 2, 6}, {0X92, AddrMode::INV, OpType::INV, 1, 2}, {0X93, AddrMode::INV, OpType::INV, 1, 2}, {0X94, AddrMode::ZPX, OpType::STY, 2, 4}, {0X95, AddrMode::ZPX, OpType::STA, 2, 4}, {0X96, AddrMode::ZPY, OpType::STX, 2, 4}, {0X97, AddrMode::INV, OpType::INV, 1, 2}, {0X98, AddrMode::IMP, OpType::TYA, 1, 2}, {0X99, AddrMode::ABY, OpType::STA, 3, 5}, {0X9A, AddrMode::IMP, OpType::TXS, 1, 2}, {0X9B, AddrMode::INV, OpType::INV, 1, 2}, {0X9C, AddrMode::INV, OpType::INV, 1, 2}, {0X9D, AddrMode::ABX, OpType::STA, 3, 5}, {0X9E, AddrMode::INV, OpType::INV, 1, 2}, {0X9F, AddrMode::INV, OpType::INV, 1, 2},
-        {0XA0, AddrMode::IMM, OpType::LDY, 2, 2}, {0XA1, AddrMode::IDX, OpType::LDA, 2, 6}, {0XA2, AddrMode::IMM, OpType::LDX, 2, 2}, {0XA3, AddrMode::INV, OpType::INV, 1, 2}, {0XA4, AddrMode::ZPG, OpType::LDY, 2, 3}, {0XA5, AddrMode::ZPG, OpType::LDA, 2, 3}, {0XA6, AddrMode::ZPG, OpType::LDX, 2, 3}, {0XA7, AddrMode::INV, OpType::INV, 1, 2}, {0XA8, AddrMode::IMP, OpType::TAY, 1, 2}, {0XA9, AddrMode::IMM, OpType::LDA, 2, 2}, {0XAA, AddrMode::IMP, OpType::TAX, 1, 2}, {0XAB, AddrMode::INV, OpType::INV, 1, 2}, {0XAC, AddrMode::ABS, OpType::LDY, 3, 4}, {0XAD, AddrMode::ABS, OpType::LDA, 3, 4}, {0XAE, AddrMode::ABS, OpType::LDX, 3, 4}, {0XAF, AddrMode::INV, OpType::INV, 1, 2},
-        {0XB0, AddrMode::REL, OpType::BCS, 2, 2}, {0XB1, AddrMode::IDY, OpType::LDA, 2, 5}, {0XB2, AddrMode::INV, OpType::INV, 1, 2}, {0XB3, AddrMode::INV, OpType::INV, 1, 2}, {0XB4, AddrMode::ZPX, OpType::LDY, 2, 4}, {0XB5, AddrMode::ZPX, OpType::LDA, 2, 4}, {0XB6, AddrMode::ZPY, OpType::LDX, 2, 4}, {0XB7, AddrMode::INV, OpType::INV, 1, 2}, {0XB8, AddrMode::IMP, OpType::CLV, 1, 2}, {0XB9, AddrMode::ABY, OpType::LDA, 3, 4}, {0XBA, AddrMode::IMP, OpType::TSX, 1, 2}, {0XBB, AddrMode::INV, OpType::INV, 1, 2}, {0XBC, AddrMode::ABX, OpType::LDY, 3, 4}, {0XBD, AddrMode::ABX, OpType::LDA, 3, 4}, {0XBE, AddrMode::ABY, OpType::LDX, 3, 4}, {0XBF, AddrMode::INV, OpType::INV, 1, 2},
-        {0XC0, AddrMode::IMM, OpType::CPY, 2, 2}, {0XC1, AddrMode::IDX, OpType::CMP, 2, 6}, {0XC2, AddrMode::INV, OpType::INV, 1, 2}, {0XC3, AddrMode::INV, OpType::INV, 1, 2}, {0XC4, AddrMode::ZPG, OpType::CPY, 2, 3}, {0XC5, AddrMode::ZPG, OpType::CMP, 2, 3}, {0XC6, AddrMode::ZPG, OpType::DEC, 2, 5}, {0XC7, AddrMode::INV, OpType::INV, 1, 2}, {0XC8, AddrMode::IMP, OpType::INY, 1, 2}, {0XC9, AddrMode::IMM, OpType::CMP, 2, 2}, {0XCA, AddrMode::IMP, OpType::DEX, 1, 2}, {0XCB, AddrMode::INV, OpType::INV, 1, 2}, {0XCC, AddrMode::ABS, OpType::CPY, 3, 4}, {0XCD, AddrMode::ABS, OpType::CMP, 3, 4}, {0XCE, AddrMode::ABS, OpType::DEC, 3, 6}, {0XCF, AddrMode::INV, OpType::INV, 1, 2},
-        {0XD0, AddrMode::REL, OpType::BNE, 2, 2}, {0XD1, AddrMode::IDY, OpType::CMP, 2, 5}, {0XD2, AddrMode::INV, OpType::INV, 1, 2}, {0XD3, AddrMode::INV, OpType::INV, 1, 2}, {0XD4, AddrMode::INV, OpType::INV, 1, 2}, {0XD5, AddrMode::ZPX, OpType::CMP, 2, 4}, {0XD6, AddrMode::ZPX, OpType::DEC, 2, 6}, {0XD7, AddrMode::INV, OpType::INV, 1, 2}, {0XD8, AddrMode::IMP, OpType::CLD, 1, 2}, {0XD9, AddrMode::ABY, OpType::CMP, 3, 4}, {0XDA, AddrMode::INV, OpType::INV, 1, 2}, {0XDB, AddrMode::INV, OpType::INV, 1, 2}, {0XDC, AddrMode::INV, OpType::INV, 1, 2}, {0XDD, AddrMode::ABX, OpType::CMP, 3, 4}, {0XDE, AddrMode::ABX, OpType::DEC, 3, 7}, {0XDF, AddrMode::INV, OpType::INV, 1, 2},
-        {0XE0, AddrMode::IMM, OpType::CPX, 2, 2}, {0XE1, AddrMode::IDX, OpType::SBC, 2, 6}, {0XE2, AddrMode::INV, OpType::INV, 1, 2}, {0XE3, AddrMode::INV, OpType::INV, 1, 2}, {0XE4, AddrMode::ZPG, OpType::CPX, 2, 3}, {0XE5, AddrMode::ZPG, OpType::SBC, 2, 3}, {0XE6, AddrMode::ZPG, OpType::INC, 2, 5}, {0XE7, AddrMode::INV, OpType::INV, 1, 2}, {0XE8, AddrMode::IMP, OpType::INX, 1, 2}, {0XE9, AddrMode::IMM, OpType::SBC, 2, 2}, {0XEA, AddrMode::IMP, OpType::NOP, 1, 2}, {0XEB, AddrMode::INV, OpType::INV, 1, 2}, {0XEC, AddrMode::ABS, OpType::CPX, 3, 4}, {0XED, AddrMode::ABS, OpType::SBC, 3, 4}, {0XEE, AddrMode::ABS, OpType::INC, 3, 6}, {0XEF, AddrMode::INV, OpType::INV, 1, 2},
-        {0XF0, AddrMode::REL, OpType::BEQ, 2, 2}, {0XF1, AddrMode::IDY, OpType::SBC, 2, 5}, {0XF2, AddrMode::INV, OpType::INV, 1, 2}, {0XF3, AddrMode::INV, OpType::INV, 1, 2}, {0XF4, AddrMode::INV, OpType::INV, 1, 2}, {0XF5, AddrMode::ZPX, OpType::SBC, 2, 4}, {0XF6, AddrMode::ZPX, OpType::INC, 2, 6}, {0XF7, AddrMode::INV, OpType::INV, 1, 2}, {0XF8, AddrMode::IMP, OpType::SED, 1, 2}, {0XF9, AddrMode::ABY, OpType::SBC, 3, 4}, {0XFA, AddrMode::INV, OpType::INV, 1, 2}, {0XFB, AddrMode::INV, OpType::INV, 1, 2}, {0XFC, AddrMode::INV, OpType::INV, 1, 2}, {0XFD, AddrMode::ABX, OpType::SBC, 3, 4}, {0XFE, AddrMode::ABX, OpType::INC, 3, 7}, {0XFF, AddrMode::INV, OpType::INV, 1, 2}
-    };
+    return &ISA[opcode];
+}
+
+// How many bytes the addressing mode reads after the opcode. The immediate
+// operand is left in place, the operation reads it from addr_eff
+int CPU::GetOperandBytes(AddrMode addr_mode) {
+    switch (addr_mode) {
+    case AddrMode::ABS: case AddrMode::ABX: case AddrMode::ABY:
+    case AddrMode::IND:
+        return 2;
+    case AddrMode::ZPG: case AddrMode::ZPX: case AddrMode::ZPY:
+    case AddrMode::REL: case AddrMode::IDX: case AddrMode::IDY:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+// Returns the decoded instruction at pc, or null if pc isn't in PRG ROM.
+// PRG ROM is the only memory the mappers map read only
+const CPU::Predecoded* CPU::FetchPredecoded() {
+    CPUMemoryMap& cpu_map = bus.GetCPUMap();
+    const uint8_t* page = cpu_map.GetReadPage(pc);
+    if (page == nullptr || cpu_map.GetWritePage(pc) != nullptr)
+        return nullptr;
+
+    Cart& cart = bus.GetCart();
+    const std::vector<uint8_t>& prg_rom = cart.GetPrgRomRef();
+    if (rom_code_version != cart.GetPrgRomVersion()) {
+        rom_code.assign(prg_rom.size(), Predecoded{});
+        rom_code_version = cart.GetPrgRomVersion();
+    }
 
-    return &isa[opcode];
+    size_t page_off = pc % CPUMemoryMap::PAGE_SIZE;
+    Predecoded& code = rom_code[page - prg_rom.data() + page_off];
+    if (code.handler == nullptr) {
+        uint8_t opcode = page[page_off];
+        int nbytes = GetOperandBytes(ISA[opcode].addr_mode);
+        // The next page may be a different bank by the time this runs again
+        if (page_off + nbytes >= CPUMemoryMap::PAGE_SIZE)
+            return nullptr;
+
+        code.operand = 0;
+        for (int i = 0; i < nbytes; i++)
+            code.operand |= page[page_off + 1 + i] << (8 * i);
+        code.opcode = opcode;
+        code.length = 1 + nbytes;
+        code.handler = HANDLERS[opcode];
+    }
+
+    return &code;
+}
+
+// Reads the operand bytes of instr from pc, for code that isn't predecoded
+void CPU::FetchOperandBytes() {
+    int nbytes = GetOperandBytes(instr->addr_mode);
+    operand = 0;
+    for (int i = 0; i < nbytes; i++)
+        operand |= bus.Read(pc++) << (8 * i);
 }
 
 /* Helper Functions */
@@ -123,6 +182,38 @@ void CPU::SetPC(uint16_t _pc) {
     pc = _pc;
 }
 
+// Can be flipped at any time, both paths leave the CPU in the same state
+// after every instruction. The cache is kept so turning it back on is free
+void CPU::SetPredecode(bool _predecode) {
+    predecode = _predecode;
+}
+
+// Called after a jump or taken branch back to pc, with the next fetch
+// (from pc) cycles_rem cycles away
+void CPU::DetectIdleLoop() {
+    uint64_t fetch = cycles_count + cycles_rem;
+    if (idle_pure && pc == idle_head && a == idle_a && x == idle_x
+        && y == idle_y && sp == idle_sp && GetStatus() == idle_status)
+        idle_period = (int)(fetch - idle_fetch);
+
+    idle_head = pc;
+    idle_a = a;
+    idle_x = x;
+    idle_y = y;
+    idle_sp = sp;
+    idle_status = GetStatus();
+    idle_fetch = fetch;
+    idle_pure = true;
+}
+
+// The instruction that closed the loop is stretched over ntrips more trips
+// around it, which leaves the CPU exactly where those trips would have
+void CPU::SkipIdleLoop(uint64_t ntrips) {
+    cycles_rem += (int)(ntrips * idle_period);
+    idle_fetch += ntrips * idle_period;
+    idle_period = 0;
+}
+
 // Stack helper functions
 bool CPU::DumpRAM() {
     std::ofstream file("c:/Users/edwar/OneDrive/Documents/Personal Code/nescle/logs/ram_dump.bin", std::ios::binary);
@@ -151,6 +242,26 @@ uint8_t CPU::FetchOperand() {
     return bus.Read(addr_eff);
 }
 
+// N and Z are only worked out from nz when something needs them
+uint8_t CPU::GetStatus() const {
+    uint8_t p = status & ~(STATUS_NEGATIVE | STATUS_ZERO);
+    if (nz & 0x8080)
+        p |= STATUS_NEGATIVE;
+    if ((nz & 0xff) == 0)
+        p |= STATUS_ZERO;
+    return p;
+}
+
+void CPU::LoadStatus(uint8_t p) {
+    status = p;
+    nz = (p & STATUS_NEGATIVE) << 8 | !(p & STATUS_ZERO);
+}
+
+// Sets N and Z from res
+void CPU::SetNZ(uint8_t res) {
+    nz = res;
+}
+
 void CPU::SetStatus(uint8_t flag, bool set) {
     if (set)
         status |= flag;
@@ -177,21 +288,18 @@ void CPU::AddrMode_IMM() {
 
 // addr_eff = (msb << 8) | lsb
 void CPU::AddrMode_ABS() {
-    uint8_t lsb = bus.Read(pc++);
-    uint8_t msb = bus.Read(pc++);
-
-    addr_eff = (msb << 8) | lsb;
+    addr_eff = operand;
 }
 
 // addr_eff = off
 void CPU::AddrMode_ZPG() {
-    uint8_t off = bus.Read(pc++);
+    uint8_t off = operand;
     addr_eff = off;
 }
 
 // addr_eff = (off + cpu->x) % 256
 void CPU::AddrMode_ZPX() {
-    uint8_t off = bus.Read(pc++);
+    uint8_t off = operand;
     // Cast the additon back to the 8-bit domain to achieve the
     // desired overflow (wrap around) behavior
     addr_eff = (uint8_t)(off + x);
@@ -199,38 +307,28 @@ void CPU::AddrMode_ZPX() {
 
 // addr_eff = (off + cpu->y) % 256
 void CPU::AddrMode_ZPY() {
-    uint8_t off = bus.Read(pc++);
+    uint8_t off = operand;
     // Cast the additon back to the 8-bit domain to achieve the
     // desired overflow (wrap around) behavior
     addr_eff = (uint8_t)(off + y);
 }
 
 // addr_eff = ((msb << 8) | lsb) + cpu->x
-void CPU::AddrMode_ABX() {
-    uint8_t lsb = bus.Read(pc++);
-    uint8_t msb = bus.Read(pc++);
-
-    addr_eff = ((msb << 8) | lsb) + x;
+bool CPU::AddrMode_ABX() {
+    addr_eff = operand + x;
 
-    // Take an extra clock cycle if page changed (hi byte changed)
-    // ST_  instructions do not incur the extra cycle
-    if (instr->op_type != OpType::STA && instr->op_type != OpType::STX
-        && instr->op_type != OpType::STY)
-        cycles_rem += ((addr_eff >> 8) != msb);
+    // Returns if the page changed (hi byte changed), Exec decides whether
+    // that costs the instruction an extra cycle
+    return (addr_eff >> 8) != (operand >> 8);
 }
 
 // addr_eff = ((msb << 8) | lsb) + cpu->y
-void CPU::AddrMode_ABY() {
-    uint8_t lsb = bus.Read(pc++);
-    uint8_t msb = bus.Read(pc++);
+bool CPU::AddrMode_ABY() {
+    addr_eff = operand + y;
 
-    addr_eff = ((msb << 8) | lsb) + y;
-
-    // Take an extra clock cycle if page changed (hi byte changed)
-    // ST_  instructions do not incur the extra cycle
-    if (instr->op_type != OpType::STA && instr->op_type != OpType::STX
-        && instr->op_type != OpType::STY)
-        cycles_rem += ((addr_eff >> 8) != msb);
+    // Returns if the page changed (hi byte changed), Exec decides whether
+    // that costs the instruction an extra cycle
+    return (addr_eff >> 8) != (operand >> 8);
 }
 
 // Work is done on the implied register, so there is no address to operate on
@@ -238,13 +336,13 @@ void CPU::AddrMode_IMP() {}
 
 // addr_eff = *pc + pc
 void CPU::AddrMode_REL() {
-    int8_t off = (int8_t)bus.Read(pc++);
+    int8_t off = (int8_t)operand;
     addr_eff = pc + off;
 }
 
 // addr_eff = (*((off + x + 1) % 256) >> 8) | *((off + x) % 256)
 void CPU::AddrMode_IDX() {
-    uint8_t off = bus.Read(pc++);
+    uint8_t off = operand;
 
     // Perform addition on 8-bit variable to force desired
     // overflow (wrap around) behavior
@@ -256,8 +354,8 @@ void CPU::AddrMode_IDX() {
 }
 
 // addr_eff = ((*(off) >> 8) | (*((off + 1) % 256))) + y
-void CPU::AddrMode_IDY() {
-    uint8_t off = bus.Read(pc++);
+bool CPU::AddrMode_IDY() {
+    uint8_t off = operand;
 
     // Perform addition on 8-bit variable to force desired
     // overflow (wrap around) behavior
@@ -266,22 +364,19 @@ void CPU::AddrMode_IDY() {
 
     addr_eff = ((msb << 8) | lsb) + y;
 
-    // Take an extra clock cycle if page changed (hi byte changed)
-    // ST_  instructions do not incur the extra cycle
-    if (instr->op_type != OpType::STA && instr->op_type != OpType::STX
-        && instr->op_type != OpType::STY)
-        cycles_rem += ((addr_eff >> 8) != msb);
+    // Returns if the page changed (hi byte changed), Exec decides whether
+    // that costs the instruction an extra cycle
+    return (addr_eff >> 8) != msb;
 }
 
 // addr_eff = (*(addr + 1) << 8) | *(addr)
 void CPU::AddrMode_IND() {
-    uint8_t lsb = bus.Read(pc++);
-    uint8_t msb = bus.Read(pc++);
+    uint8_t lsb = (uint8_t)operand;
 
-    // The lsb and msb are the bytes of an address that we are pointing to.
-    // In order to properly set addr_eff, we will need to read from the address
+    // The operand is the address that we are pointing to. In order to
+    // properly set addr_eff, we will need to read from the address
     // that this points to
-    uint16_t addr = (msb << 8) | lsb;
+    uint16_t addr = operand;
 
     /*
      * If the lsb is 0xff, that means we need to cross a page boundary to
@@ -353,8 +448,7 @@ void CPU::Op_ADC() {
 
     SetStatus(STATUS_OVERFLOW, ovr);
     SetStatus(STATUS_CARRY, res > 0xff);
-    SetStatus(STATUS_ZERO, a == 0);
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(a));
+    SetNZ(a);
 }
 
 // A & M -> A
@@ -362,8 +456,7 @@ void CPU::Op_AND() {
     uint8_t operand = FetchOperand();
     a = a & operand;
 
-    SetStatus(STATUS_ZERO, a == 0);
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(a));
+    SetNZ(a);
 }
 
 // Left shift 1 bit, target depends on addressing mode
@@ -373,8 +466,7 @@ void CPU::Op_ASL() {
         bool carry = a & (1 << 7);
         a = a << 1;
 
-        SetStatus(STATUS_ZERO, a == 0);
-        SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(a));
+        SetNZ(a);
         SetStatus(STATUS_CARRY, carry);
     } else {
         uint8_t operand = FetchOperand();
@@ -382,8 +474,7 @@ void CPU::Op_ASL() {
 
         bus.Write(addr_eff, res);
 
-        SetStatus(STATUS_ZERO, res == 0);
-        SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(res));
+        SetNZ(res);
         SetStatus(STATUS_CARRY, operand & (1 << 7));
     }
 }
@@ -402,7 +493,7 @@ void CPU::Op_BCS() {
 
 // Branch on STATUS_ZERO
 void CPU::Op_BEQ() {
-    if (status & STATUS_ZERO)
+    if ((nz & 0xff) == 0)
         Branch();
 }
 
@@ -411,26 +502,27 @@ void CPU::Op_BIT() {
     uint8_t operand = FetchOperand();
     uint8_t res = a & operand;
 
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(operand));
-    SetStatus(STATUS_ZERO, res == 0);
+    // N comes from the operand rather than the result, res can only have
+    // bit 7 set if the operand does
+    nz = res | (operand & 0x80) << 8;
     SetStatus(STATUS_OVERFLOW, operand & (1 << 6));
 }
 
 // Branch on STATUS_NEGATIVE
 void CPU::Op_BMI() {
-    if (status & STATUS_NEGATIVE)
+    if (nz & 0x8080)
         Branch();
 }
 
 // Branch on !STATUS_ZERO
 void CPU::Op_BNE() {
-    if (!(status & STATUS_ZERO))
+    if ((nz & 0xff) != 0)
         Branch();
 }
 
 // Branch on !STATUS_NEGATIVE
 void CPU::Op_BPL() {
-    if (!(status & STATUS_NEGATIVE))
+    if (!(nz & 0x8080))
         Branch();
 }
 
@@ -447,7 +539,7 @@ void CPU::Op_BRK() {
 
     // Set break flag, push status register, and set IRQ flag
     SetStatus(STATUS_BRK, true);
-    StackPush(status);
+    StackPush(GetStatus());
     SetStatus(STATUS_IRQ, true);
 
     // FIXME: THIS MAY BE WRONG (OLC HAS IT, BUT INSTRUCTIONS DON'T)
@@ -497,8 +589,7 @@ void CPU::Op_CMP() {
     uint8_t res = a - operand;
 
     SetStatus(STATUS_CARRY, a >= operand);
-    SetStatus(STATUS_ZERO, res == 0);
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(res));
+    SetNZ(res);
 }
 
 // X - M
@@ -507,8 +598,7 @@ void CPU::Op_CPX() {
     uint8_t res = x - operand;
 
     SetStatus(STATUS_CARRY, x >= operand);
-    SetStatus(STATUS_ZERO, res == 0);
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(res));
+    SetNZ(res);
 }
 
 // Y - M
@@ -517,8 +607,7 @@ void CPU::Op_CPY() {
     uint8_t res = y - operand;
 
     SetStatus(STATUS_CARRY, y >= operand);
-    SetStatus(STATUS_ZERO, res == 0);
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(res));
+    SetNZ(res);
 }
 
 // M - 1 -> M
@@ -528,24 +617,21 @@ void CPU::Op_DEC() {
 
     bus.Write(addr_eff, res);
 
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(res));
-    SetStatus(STATUS_ZERO, res == 0);
+    SetNZ(res);
 }
 
 // X - 1 -> X
 void CPU::Op_DEX() {
     x = x - 1;
 
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(x));
-    SetStatus(STATUS_ZERO, x == 0);
+    SetNZ(x);
 }
 
 // Y - 1 -> Y
 void CPU::Op_DEY() {
     y = y - 1;
 
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(y));
-    SetStatus(STATUS_ZERO, y == 0);
+    SetNZ(y);
 }
 
 // A ^ M -> A
@@ -553,8 +639,7 @@ void CPU::Op_EOR() {
     uint8_t operand = FetchOperand();
     a = a ^ operand;
 
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(a));
-    SetStatus(STATUS_ZERO, a == 0);
+    SetNZ(a);
 }
 
 // M + 1 -> M
@@ -564,24 +649,21 @@ void CPU::Op_INC() {
 
     bus.Write(addr_eff, res);
 
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(res));
-    SetStatus(STATUS_ZERO, res == 0);
+    SetNZ(res);
 }
 
 // X + 1 -> X
 void CPU::Op_INX() {
     x = x + 1;
 
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(x));
-    SetStatus(STATUS_ZERO, x == 0);
+    SetNZ(x);
 }
 
 // Y + 1 -> Y
 void CPU::Op_INY() {
     y = y + 1;
 
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(y));
-    SetStatus(STATUS_ZERO, y == 0);
+    SetNZ(y);
 }
 
 // addr_eff -> pc
@@ -613,24 +695,21 @@ void CPU::Op_JSR() {
 void CPU::Op_LDA() {
     a = bus.Read(addr_eff);
 
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(a));
-    SetStatus(STATUS_ZERO, a == 0);
+    SetNZ(a);
 }
 
 // M -> X
 void CPU::Op_LDX() {
     x = bus.Read(addr_eff);
 
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(x));
-    SetStatus(STATUS_ZERO, x == 0);
+    SetNZ(x);
 }
 
 // M -> Y
 void CPU::Op_LDY() {
     y = bus.Read(addr_eff);
 
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(y));
-    SetStatus(STATUS_ZERO, y == 0);
+    SetNZ(y);
 }
 
 // Shift right 1 bit, target depends on addressing mode
@@ -640,8 +719,7 @@ void CPU::Op_LSR() {
         bool carry = a & 1;
         a = a >> 1;
 
-        SetStatus(STATUS_NEGATIVE, false);
-        SetStatus(STATUS_ZERO, a == 0);
+        SetNZ(a);
         SetStatus(STATUS_CARRY, carry);
     } else {
         uint8_t operand = FetchOperand();
@@ -649,8 +727,7 @@ void CPU::Op_LSR() {
 
         bus.Write(addr_eff, res);
 
-        SetStatus(STATUS_NEGATIVE, false);
-        SetStatus(STATUS_ZERO, res == 0);
+        SetNZ(res);
         SetStatus(STATUS_CARRY, operand & 1);
     }
 }
@@ -663,8 +740,7 @@ void CPU::Op_ORA() {
     uint8_t operand = FetchOperand();
     a = a | operand;
 
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(a));
-    SetStatus(STATUS_ZERO, a == 0);
+    SetNZ(a);
 }
 
 // A -> M(SP)   SP - 1 -> SP
@@ -678,7 +754,7 @@ void CPU::Op_PHA() {
 void CPU::Op_PHP() {
     // Break flag gets set before push
     SetStatus(STATUS_BRK, true);
-    StackPush(status);
+    StackPush(GetStatus());
     // Clear the break flag because we didn't break
     SetStatus(STATUS_BRK, false);
 }
@@ -688,14 +764,13 @@ void CPU::Op_PHP() {
 void CPU::Op_PLA() {
     a = StackPop();
 
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(a));
-    SetStatus(STATUS_ZERO, a == 0);
+    SetNZ(a);
 }
 
 // SP + 1 -> SP     M(SP) -> P
 // Pop the stack and store in status
 void CPU::Op_PLP() {
-    status = StackPop();
+    LoadStatus(StackPop());
 
     // If popping the status from an accumulator push, we must force these
     // flags to the proper status
@@ -712,8 +787,7 @@ void CPU::Op_ROL() {
         a = a | ((status & STATUS_CARRY) == STATUS_CARRY);
 
         SetStatus(STATUS_CARRY, hiset);
-        SetStatus(STATUS_ZERO, a == 0);
-        SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(a));
+        SetNZ(a);
     } else {
         uint8_t operand = FetchOperand();
         uint8_t res = operand << 1;
@@ -722,8 +796,7 @@ void CPU::Op_ROL() {
         bus.Write(addr_eff, res);
 
         SetStatus(STATUS_CARRY, operand & (1 << 7));
-        SetStatus(STATUS_ZERO, res == 0);
-        SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(res));
+        SetNZ(res);
     }
 }
 
@@ -736,8 +809,7 @@ void CPU::Op_ROR() {
         a = a | (((status & STATUS_CARRY) == STATUS_CARRY) << 7);
 
         SetStatus(STATUS_CARRY, loset);
-        SetStatus(STATUS_ZERO, a == 0);
-        SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(a));
+        SetNZ(a);
     } else {
         uint8_t operand = FetchOperand();
         uint8_t res = operand >> 1;
@@ -746,14 +818,13 @@ void CPU::Op_ROR() {
         bus.Write(addr_eff, res);
 
         SetStatus(STATUS_CARRY, operand & 1);
-        SetStatus(STATUS_ZERO, res == 0);
-        SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(res));
+        SetNZ(res);
     }
 }
 
 // Return from interrupt
 void CPU::Op_RTI() {
-    status = StackPop();
+    LoadStatus(StackPop());
 
     // If popping the status from an accumulator push, we must force these
     // flags to the proper status
@@ -803,8 +874,7 @@ void CPU::Op_SBC() {
 
     SetStatus(STATUS_OVERFLOW, ovr);
     SetStatus(STATUS_CARRY, res > 0xff);
-    SetStatus(STATUS_ZERO, a == 0);
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(a));
+    SetNZ(a);
 }
 
 // Set STATUS_CARRY
@@ -841,32 +911,28 @@ void CPU::Op_STY() {
 void CPU::Op_TAX() {
     x = a;
 
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(x));
-    SetStatus(STATUS_ZERO, x == 0);
+    SetNZ(x);
 }
 
 // A -> Y
 void CPU::Op_TAY() {
     y = a;
 
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(y));
-    SetStatus(STATUS_ZERO, y == 0);
+    SetNZ(y);
 }
 
 // SP -> X
 void CPU::Op_TSX() {
     x = sp;
 
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(x));
-    SetStatus(STATUS_ZERO, x == 0);
+    SetNZ(x);
 }
 
 // X -> A
 void CPU::Op_TXA() {
     a = x;
 
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(a));
-    SetStatus(STATUS_ZERO, a == 0);
+    SetNZ(a);
 }
 
 // X -> S
@@ -878,8 +944,7 @@ void CPU::Op_TXS() {
 void CPU::Op_TYA() {
     a = y;
 
-    SetStatus(STATUS_NEGATIVE, CPU_IS_NEG(a));
-    SetStatus(STATUS_ZERO, a == 0);
+    SetNZ(a);
 }
 
 /* Interrupts */
@@ -893,21 +958,43 @@ void CPU::Clock() {
      */
     // TODO: ATTEMPT TO AVOID LOCKING ON EVERY INSTRUCTION
     if (cycles_rem == 0) {
-        // Don't let disassembler run while in middle of instruction
-        // Fetch
-        uint8_t op = bus.Read(pc++);
+        idle_period = 0;
+
+        // Interrupts are only taken between instructions, in place of
+        // fetching the next one
+        if (interrupts == 0 || !PollInterrupts()) {
+            // Don't let disassembler run while in middle of instruction
+            // Code in PRG ROM was already fetched and decoded the first time
+            // it ran, so it can go straight to its handler
+            const Predecoded* code = predecode ? FetchPredecoded() : nullptr;
+            if (code != nullptr) {
+                pc += code->length;
+                operand = code->operand;
+                instr = &ISA[code->opcode];
+                cycles_rem = instr->cycles;
+
+#ifdef DISASSEMBLY_LOG
+                CPU_DisassembleLog(cpu);
+#endif
 
-        // Decode
-        instr = CPU::Decode(op);
-        cycles_rem = instr->cycles;
+                code->handler(*this);
+            } else {
+                // Fetch
+                uint8_t op = bus.Read(pc++);
+
+                // Decode
+                instr = CPU::Decode(op);
+                cycles_rem = instr->cycles;
 
 #ifdef DISASSEMBLY_LOG
-        CPU_DisassembleLog(cpu);
+                CPU_DisassembleLog(cpu);
 #endif
 
-        // Execute
-        SetAddrMode();
-        Execute();
+                // Execute
+                FetchOperandBytes();
+                Dispatch(op);
+            }
+        }
     }
 
     // Countdown
@@ -915,8 +1002,32 @@ void CPU::Clock() {
     cycles_count++;
 }
 
+// Same as calling Clock ncycles times, as long as none of those
+// clocks would have fetched a new instruction
+void CPU::Skip(int ncycles) {
+    cycles_rem -= ncycles;
+    cycles_count += ncycles;
+}
+
 // FIXME: WE MAY WANT THE IRQ TO BE SET BEFORE PUSHING
 // FIXME: TECHNICALLY 0X00 SHOULD BE LOADED INTO THE OPCODE REG
+// Starts the interrupt sequence for the highest priority active line the
+// CPU isn't masking. Returns false if there wasn't one
+bool CPU::PollInterrupts() {
+    if (interrupts & INTERRUPT_NMI) {
+        // The PPU keeps its flag up until the NMI is actually taken
+        interrupts &= ~INTERRUPT_NMI;
+        bus.GetPPU().ClearNMIStatus();
+        NMI();
+        return true;
+    }
+    if ((interrupts & INTERRUPT_IRQ) && !(status & STATUS_IRQ)) {
+        IRQ();
+        return true;
+    }
+    return false;
+}
+
 void CPU::IRQ() {
     if (!(status & STATUS_IRQ)) {
         // Push PC (MSB first) onto the stack
@@ -930,7 +1041,7 @@ void CPU::IRQ() {
         //set_status(cpu, 1 << 5, true);
 
         // Push status register onto the stack
-        StackPush(status);
+        StackPush(GetStatus());
         SetStatus(STATUS_IRQ, true);
 
         // Load PC from hard-coded address
@@ -938,6 +1049,7 @@ void CPU::IRQ() {
 
         // Set time for IRQ to be handled
         cycles_rem = 7;
+        idle_pure = false;
     }
 }
 
@@ -955,7 +1067,7 @@ void CPU::NMI() {
     //set_status(cpu, 1 << 5, true);     // this should already have been set
 
     // Push status register onto the stack
-    StackPush(status);
+    StackPush(GetStatus());
     SetStatus(STATUS_IRQ, true);
 
     // Load pc from hard-coded address
@@ -963,6 +1075,7 @@ void CPU::NMI() {
 
     // Set time for IRQ to be handled
     cycles_rem = 7;
+    idle_pure = false;
 }
 
 // https://www.nesdev.org/wiki/CPU_power_up_state
@@ -990,18 +1103,21 @@ void CPU::Reset() {
      * Since the state of status after a reset is irrelevant
      * to the emulation, we accept the slight emulation inaccuracy.
      */
-    status = STATUS_IRQ | (1 << 5);
+    LoadStatus(STATUS_IRQ | (1 << 5));
 
     // FIXME: THIS MAY VERY WELL CAUSE BUGS LATER WHEN APU IS ADDED
     bus.Write(0x4015, 0x00);
 
     cycles_rem = 7;
     cycles_count = 0;
+    interrupts = 0;
+    idle_pure = false;
+    idle_period = 0;
 }
 
 // https://www.nesdev.org/wiki/CPU_power_up_state
 void CPU::PowerOn() {
-    status = 0x34;
+    LoadStatus(0x34);
     a = 0;
     x = 0;
     y = 0;
@@ -1023,55 +1139,155 @@ void CPU::PowerOn() {
 }
 
 /* Fetch/Decode/Execute */
-void CPU::SetAddrMode() {
-    // Maps addressing mode to the appropriate function
-    static const std::function<void()> addrmode_funcs[(int)AddrMode::INV+1] = {
-        std::bind(&CPU::AddrMode_ACC, this),
-        std::bind(&CPU::AddrMode_IMM, this),
-        std::bind(&CPU::AddrMode_ABS, this),
-        std::bind(&CPU::AddrMode_ZPG, this),
-        std::bind(&CPU::AddrMode_ZPX, this),
-        std::bind(&CPU::AddrMode_ZPY, this),
-        std::bind(&CPU::AddrMode_ABX, this),
-        std::bind(&CPU::AddrMode_ABY, this),
-        std::bind(&CPU::AddrMode_IMP, this),
-        std::bind(&CPU::AddrMode_REL, this),
-        std::bind(&CPU::AddrMode_IDX, this),
-        std::bind(&CPU::AddrMode_IDY, this),
-        std::bind(&CPU::AddrMode_IND, this),
-
-        // Invalid addressing mode uses implied addressing mode
-        std::bind(&CPU::AddrMode_IMP, this)
-    };
-
-    addrmode_funcs[(int)instr->addr_mode]();
-}
-
-void CPU::Execute() {
-    // Maps OpType to the appropriate 6502 operation
-    static const std::function<void()> op_funcs[(int)OpType::INV+1] = {
-        std::bind(&CPU::Op_ADC, this), std::bind(&CPU::Op_AND, this), std::bind(&CPU::Op_ASL, this),
-        std::bind(&CPU::Op_BCC, this), std::bind(&CPU::Op_BCS, this), std::bind(&CPU::Op_BEQ, this), std::bind(&CPU::Op_BIT, this), std::bind(&CPU::Op_BMI, this), std::bind(&CPU::Op_BNE, this), std::bind(&CPU::Op_BPL, this), std::bind(&CPU::Op_BRK, this), std::bind(&CPU::Op_BVC, this), std::bind(&CPU::Op_BVS, this),
-        std::bind(&CPU::Op_CLC, this), std::bind(&CPU::Op_CLD, this), std::bind(&CPU::Op_CLI, this), std::bind(&CPU::Op_CLV, this), std::bind(&CPU::Op_CMP, this), std::bind(&CPU::Op_CPX, this), std::bind(&CPU::Op_CPY, this),
-        std::bind(&CPU::Op_DEC, this), std::bind(&CPU::Op_DEX, this), std::bind(&CPU::Op_DEY, this),
-        std::bind(&CPU::Op_EOR, this),
-        std::bind(&CPU::Op_INC, this), std::bind(&CPU::Op_INX, this), std::bind(&CPU::Op_INY, this),
-        std::bind(&CPU::Op_JMP, this), std::bind(&CPU::Op_JSR, this),
-        std::bind(&CPU::Op_LDA, this), std::bind(&CPU::Op_LDX, this), std::bind(&CPU::Op_LDY, this), std::bind(&CPU::Op_LSR, this),
-        std::bind(&CPU::Op_NOP, this),
-        std::bind(&CPU::Op_ORA, this),
-        std::bind(&CPU::Op_PHA, this), std::bind(&CPU::Op_PHP, this), std::bind(&CPU::Op_PLA, this), std::bind(&CPU::Op_PLP, this),
-        std::bind(&CPU::Op_ROL, this), std::bind(&CPU::Op_ROR, this), std::bind(&CPU::Op_RTI, this), std::bind(&CPU::Op_RTS, this),
-        std::bind(&CPU::Op_SBC, this), std::bind(&CPU::Op_SEC, this), std::bind(&CPU::Op_SED, this), std::bind(&CPU::Op_SEI, this), std::bind(&CPU::Op_STA, this), std::bind(&CPU::Op_STX, this), std::bind(&CPU::Op_STY, this),
-        std::bind(&CPU::Op_TAX, this), std::bind(&CPU::Op_TAY, this), std::bind(&CPU::Op_TSX, this), std::bind(&CPU::Op_TXA, this), std::bind(&CPU::Op_TXS, this), std::bind(&CPU::Op_TYA, this),
-
-        // Invalid opcode is handled as a NOP
-        std::bind(&CPU::Op_NOP, this)
-    };
+// Every branch below is resolved at compile time, so each instantiation is
+// a straight line of addressing mode + operation with no table lookups
+template <uint8_t opcode>
+void CPU::Exec() {
+    constexpr AddrMode addr_mode = ISA[opcode].addr_mode;
+    constexpr OpType op_type = ISA[opcode].op_type;
+    // ST_ instructions do not incur the extra cycle on a page cross
+    constexpr bool page_penalty = op_type != OpType::STA
+        && op_type != OpType::STX && op_type != OpType::STY;
+    // Anything that writes memory or the stack can't be part of an idle
+    // loop, nor can JMP (ind), which reads its pointer from anywhere
+    constexpr bool idle_safe = op_type != OpType::STA
+        && op_type != OpType::STX && op_type != OpType::STY
+        && op_type != OpType::INC && op_type != OpType::DEC
+        && (addr_mode == AddrMode::ACC || (op_type != OpType::ASL
+            && op_type != OpType::LSR && op_type != OpType::ROL
+            && op_type != OpType::ROR))
+        && op_type != OpType::PHA && op_type != OpType::PHP
+        && op_type != OpType::PLA && op_type != OpType::PLP
+        && op_type != OpType::JSR && op_type != OpType::RTS
+        && op_type != OpType::RTI && op_type != OpType::BRK
+        && !(op_type == OpType::JMP && addr_mode == AddrMode::IND);
+    // Only these can close a loop
+    constexpr bool jump = op_type == OpType::BCC || op_type == OpType::BCS
+        || op_type == OpType::BEQ || op_type == OpType::BMI
+        || op_type == OpType::BNE || op_type == OpType::BPL
+        || op_type == OpType::BVC || op_type == OpType::BVS
+        || (op_type == OpType::JMP && addr_mode == AddrMode::ABS);
+
+    // Invalid addressing mode uses implied addressing mode
+    if constexpr (addr_mode == AddrMode::ACC) AddrMode_ACC();
+    else if constexpr (addr_mode == AddrMode::IMM) AddrMode_IMM();
+    else if constexpr (addr_mode == AddrMode::ABS) AddrMode_ABS();
+    else if constexpr (addr_mode == AddrMode::ZPG) AddrMode_ZPG();
+    else if constexpr (addr_mode == AddrMode::ZPX) AddrMode_ZPX();
+    else if constexpr (addr_mode == AddrMode::ZPY) AddrMode_ZPY();
+    else if constexpr (addr_mode == AddrMode::ABX) { bool crossed = AddrMode_ABX(); if constexpr (page_penalty) cycles_rem += crossed; }
+    else if constexpr (addr_mode == AddrMode::ABY) { bool crossed = AddrMode_ABY(); if constexpr (page_penalty) cycles_rem += crossed; }
+    else if constexpr (addr_mode == AddrMode::REL) AddrMode_REL();
+    else if constexpr (addr_mode == AddrMode::IDX) AddrMode_IDX();
+    else if constexpr (addr_mode == AddrMode::IDY) { bool crossed = AddrMode_IDY(); if constexpr (page_penalty) cycles_rem += crossed; }
+    else if constexpr (addr_mode == AddrMode::IND) AddrMode_IND();
+    else AddrMode_IMP();
+
+    [[maybe_unused]] uint16_t next_pc = pc;
+
+    // Invalid opcode is handled as a NOP
+    if constexpr (op_type == OpType::ADC) Op_ADC();
+    else if constexpr (op_type == OpType::AND) Op_AND();
+    else if constexpr (op_type == OpType::ASL) Op_ASL();
+    else if constexpr (op_type == OpType::BCC) Op_BCC();
+    else if constexpr (op_type == OpType::BCS) Op_BCS();
+    else if constexpr (op_type == OpType::BEQ) Op_BEQ();
+    else if constexpr (op_type == OpType::BIT) Op_BIT();
+    else if constexpr (op_type == OpType::BMI) Op_BMI();
+    else if constexpr (op_type == OpType::BNE) Op_BNE();
+    else if constexpr (op_type == OpType::BPL) Op_BPL();
+    else if constexpr (op_type == OpType::BRK) Op_BRK();
+    else if constexpr (op_type == OpType::BVC) Op_BVC();
+    else if constexpr (op_type == OpType::BVS) Op_BVS();
+    else if constexpr (op_type == OpType::CLC) Op_CLC();
+    else if constexpr (op_type == OpType::CLD) Op_CLD();
+    else if constexpr (op_type == OpType::CLI) Op_CLI();
+    else if constexpr (op_type == OpType::CLV) Op_CLV();
+    else if constexpr (op_type == OpType::CMP) Op_CMP();
+    else if constexpr (op_type == OpType::CPX) Op_CPX();
+    else if constexpr (op_type == OpType::CPY) Op_CPY();
+    else if constexpr (op_type == OpType::DEC) Op_DEC();
+    else if constexpr (op_type == OpType::DEX) Op_DEX();
+    else if constexpr (op_type == OpType::DEY) Op_DEY();
+    else if constexpr (op_type == OpType::EOR) Op_EOR();
+    else if constexpr (op_type == OpType::INC) Op_INC();
+    else if constexpr (op_type == OpType::INX) Op_INX();
+    else if constexpr (op_type == OpType::INY) Op_INY();
+    else if constexpr (op_type == OpType::JMP) Op_JMP();
+    else if constexpr (op_type == OpType::JSR) Op_JSR();
+    else if constexpr (op_type == OpType::LDA) Op_LDA();
+    else if constexpr (op_type == OpType::LDX) Op_LDX();
+    else if constexpr (op_type == OpType::LDY) Op_LDY();
+    else if constexpr (op_type == OpType::LSR) Op_LSR();
+    else if constexpr (op_type == OpType::ORA) Op_ORA();
+    else if constexpr (op_type == OpType::PHA) Op_PHA();
+    else if constexpr (op_type == OpType::PHP) Op_PHP();
+    else if constexpr (op_type == OpType::PLA) Op_PLA();
+    else if constexpr (op_type == OpType::PLP) Op_PLP();
+    else if constexpr (op_type == OpType::ROL) Op_ROL();
+    else if constexpr (op_type == OpType::ROR) Op_ROR();
+    else if constexpr (op_type == OpType::RTI) Op_RTI();
+    else if constexpr (op_type == OpType::RTS) Op_RTS();
+    else if constexpr (op_type == OpType::SBC) Op_SBC();
+    else if constexpr (op_type == OpType::SEC) Op_SEC();
+    else if constexpr (op_type == OpType::SED) Op_SED();
+    else if constexpr (op_type == OpType::SEI) Op_SEI();
+    else if constexpr (op_type == OpType::STA) Op_STA();
+    else if constexpr (op_type == OpType::STX) Op_STX();
+    else if constexpr (op_type == OpType::STY) Op_STY();
+    else if constexpr (op_type == OpType::TAX) Op_TAX();
+    else if constexpr (op_type == OpType::TAY) Op_TAY();
+    else if constexpr (op_type == OpType::TSX) Op_TSX();
+    else if constexpr (op_type == OpType::TXA) Op_TXA();
+    else if constexpr (op_type == OpType::TXS) Op_TXS();
+    else if constexpr (op_type == OpType::TYA) Op_TYA();
+    else Op_NOP();
+
+    if constexpr (!idle_safe)
+        idle_pure = false;
+    else if constexpr (jump) {
+        if (pc < next_pc)
+            DetectIdleLoop();
+    }
+}
 
-    op_funcs[(int)instr->op_type]();
+// Handlers are per CPU instance (no bound this pointers), so any number of
+// Bus objects can run side by side
+#define CPU_EXEC_CASE(op) case op: Exec<op>(); break;
+#define CPU_EXEC_ROW(hi) \
+    CPU_EXEC_CASE(hi + 0x0) CPU_EXEC_CASE(hi + 0x1) CPU_EXEC_CASE(hi + 0x2) CPU_EXEC_CASE(hi + 0x3) \
+    CPU_EXEC_CASE(hi + 0x4) CPU_EXEC_CASE(hi + 0x5) CPU_EXEC_CASE(hi + 0x6) CPU_EXEC_CASE(hi + 0x7) \
+    CPU_EXEC_CASE(hi + 0x8) CPU_EXEC_CASE(hi + 0x9) CPU_EXEC_CASE(hi + 0xa) CPU_EXEC_CASE(hi + 0xb) \
+    CPU_EXEC_CASE(hi + 0xc) CPU_EXEC_CASE(hi + 0xd) CPU_EXEC_CASE(hi + 0xe) CPU_EXEC_CASE(hi + 0xf)
+
+void CPU::Dispatch(uint8_t opcode) {
+    switch (opcode) {
+    CPU_EXEC_ROW(0x00) CPU_EXEC_ROW(0x10) CPU_EXEC_ROW(0x20) CPU_EXEC_ROW(0x30)
+    CPU_EXEC_ROW(0x40) CPU_EXEC_ROW(0x50) CPU_EXEC_ROW(0x60) CPU_EXEC_ROW(0x70)
+    CPU_EXEC_ROW(0x80) CPU_EXEC_ROW(0x90) CPU_EXEC_ROW(0xa0) CPU_EXEC_ROW(0xb0)
+    CPU_EXEC_ROW(0xc0) CPU_EXEC_ROW(0xd0) CPU_EXEC_ROW(0xe0) CPU_EXEC_ROW(0xf0)
+    }
 }
 
+#undef CPU_EXEC_ROW
+#undef CPU_EXEC_CASE
+
+// The same handlers as Dispatch, for predecoded code to call directly
+#define CPU_HANDLER_ROW(hi) \
+    &ExecHandler<hi + 0x0>, &ExecHandler<hi + 0x1>, &ExecHandler<hi + 0x2>, &ExecHandler<hi + 0x3>, \
+    &ExecHandler<hi + 0x4>, &ExecHandler<hi + 0x5>, &ExecHandler<hi + 0x6>, &ExecHandler<hi + 0x7>, \
+    &ExecHandler<hi + 0x8>, &ExecHandler<hi + 0x9>, &ExecHandler<hi + 0xa>, &ExecHandler<hi + 0xb>, \
+    &ExecHandler<hi + 0xc>, &ExecHandler<hi + 0xd>, &ExecHandler<hi + 0xe>, &ExecHandler<hi + 0xf>,
+
+const std::array<CPU::Handler, 256> CPU::HANDLERS = {
+    CPU_HANDLER_ROW(0x00) CPU_HANDLER_ROW(0x10) CPU_HANDLER_ROW(0x20) CPU_HANDLER_ROW(0x30)
+    CPU_HANDLER_ROW(0x40) CPU_HANDLER_ROW(0x50) CPU_HANDLER_ROW(0x60) CPU_HANDLER_ROW(0x70)
+    CPU_HANDLER_ROW(0x80) CPU_HANDLER_ROW(0x90) CPU_HANDLER_ROW(0xa0) CPU_HANDLER_ROW(0xb0)
+    CPU_HANDLER_ROW(0xc0) CPU_HANDLER_ROW(0xd0) CPU_HANDLER_ROW(0xe0) CPU_HANDLER_ROW(0xf0)
+};
+
+#undef CPU_HANDLER_ROW
+
 /* Disassembler */
 // TODO: MAKE THIS RETURN A STD::STRING
 // Returns a string of the disassembled instruction at addr
@@ -1276,7 +1492,7 @@ std::string CPU::DisassembleString(uint16_t addr) {
 
     sprintf(ret,
         "%04X  %-8s %-31s  A:%02X X:%02X Y:%02X P:%02X SP:%02X PPU:%3u,%3u CYC:%u",
-        addr, bytecode, disas, a, x, y, status, sp,
+        addr, bytecode, disas, a, x, y, GetStatus(), sp,
         (unsigned int)(cycles_count*3/341),
         (unsigned int)(cycles_count*3%341),
         (unsigned int)cycles_count);
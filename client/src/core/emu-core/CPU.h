@@ -17,9 +17,11 @@
 #ifndef CPU_H_
 #define CPU_H_
 
+#include <array>
 #include <cstdint>
 #include <cstdio>
 #include <string>
+#include <vector>
 
 #include <nlohmann/json.hpp>
 
@@ -89,6 +91,9 @@ private:
         const int cycles;
     };
 
+    // 6502 ISA indexed by opcode
+    static const Instr ISA[256];
+
     Bus& bus;
 
     // Registers
@@ -96,18 +101,64 @@ private:
     uint8_t y;      // Y
     uint8_t x;      // X
     uint8_t sp;     // Stack Pointer
-    uint8_t status; // Status Register
+    uint8_t status; // Status Register, except N and Z, see nz
+    // N and Z are set by almost every instruction but rarely looked at, so
+    // instead of updating status this holds the result that set them. Z is
+    // set if the low byte is 0, N if bit 7 or 15 is set (BIT takes N from
+    // its operand). GetStatus puts the whole register together
+    uint16_t nz;
     uint16_t pc;    // Program Counter
 
+    uint8_t interrupts = 0; // Interrupt lines that are active, see Interrupt
+
     const Instr* instr;    // Current instruction
+    uint16_t operand;  // Operand bytes of current instruction, little endian
     uint16_t addr_eff; // Effective address of current instruction
     int cycles_rem;     // Number of cycles remaining for current instruction
     uint64_t cycles_count; // NUmber of CPU clocks
 
+    using Handler = void (*)(CPU& cpu);
+
+    // An instruction in PRG ROM, decoded the first time it runs
+    struct Predecoded {
+        Handler handler;    // Null until decoded
+        uint16_t operand;
+        uint8_t opcode;
+        uint8_t length;     // How far pc moves before the handler runs
+    };
+
+    // Indexed by PRG ROM offset, which is the bank and the address in one,
+    // so a bank switch just changes which entries pc lands on. Only code in
+    // PRG ROM is kept, anything running from RAM is decoded every time
+    std::vector<Predecoded> rom_code;
+    uint32_t rom_code_version = 0;  // Cart PRG ROM version rom_code is for
+    bool predecode = true;          // Off runs everything through Dispatch
+
+    // Idle loop detection. A loop closes each time a jump or taken branch
+    // goes back to idle_head. If nothing since the last time wrote memory
+    // or touched anything but RAM and ROM, and the registers are back to
+    // what they were, every trip around it will be the same until the CPU
+    // is interrupted
+    uint16_t idle_head = 0;
+    uint8_t idle_a, idle_x, idle_y, idle_sp, idle_status;
+    uint64_t idle_fetch = 0;    // When the CPU last went back to idle_head
+    bool idle_pure = false;
+    int idle_period = 0;        // Cycles per trip, if the last instr closed it
+
     const Instr* Decode(uint8_t opcode);
+    static int GetOperandBytes(AddrMode addr_mode);
+    const Predecoded* FetchPredecoded();
+    void FetchOperandBytes();
+    bool PollInterrupts();
+    void IRQ();
+    void NMI();
+    void DetectIdleLoop();
     uint8_t StackPop();
     bool StackPush(uint8_t data);
     uint8_t FetchOperand();
+    uint8_t GetStatus() const;
+    void LoadStatus(uint8_t p);
+    void SetNZ(uint8_t res);
     void SetStatus(uint8_t flag, bool set);
     void Branch();
 
@@ -118,12 +169,12 @@ private:
     void AddrMode_ZPG(); // 2-bytes, addr,   second byte is the offset from the zero page
     void AddrMode_ZPX(); // 2-bytes, addr,   zeropage but offset is indexed by x
     void AddrMode_ZPY(); // 2-bytes, addr,   zeropage but offset is indexed by y
-    void AddrMode_ABX(); // 3-bytes, addr,   absolute address indexed by x
-    void AddrMode_ABY(); // 3-bytes, addr,   absolute address indexed by y
+    bool AddrMode_ABX(); // 3-bytes, addr,   absolute address indexed by x
+    bool AddrMode_ABY(); // 3-bytes, addr,   absolute address indexed by y
     void AddrMode_IMP(); // 1-byte,  reg,    implied
     void AddrMode_REL(); // 2-bytes, addr,   relative address
     void AddrMode_IDX(); // 2-bytes, addr,   indexed indirect
-    void AddrMode_IDY(); // 2-bytes, addr,   indirect indexed
+    bool AddrMode_IDY(); // 2-bytes, addr,   indirect indexed
     void AddrMode_IND(); // 3-bytes, addr,   indirect
 
     // Instructions
@@ -142,24 +193,52 @@ private:
     void Op_SBC(); void Op_SEC(); void Op_SED(); void Op_SEI(); void Op_STA(); void Op_STX(); void Op_STY();
     void Op_TAX(); void Op_TAY(); void Op_TSX(); void Op_TXA(); void Op_TXS(); void Op_TYA();
 
+    // Fetch/Decode/Execute
+    // One handler is instantiated per opcode, with the addressing mode and
+    // operation picked at compile time from ISA
+    template <uint8_t opcode> void Exec();
+    template <uint8_t opcode> static void ExecHandler(CPU& cpu) { cpu.Exec<opcode>(); }
+    static const std::array<Handler, 256> HANDLERS;
+    void Dispatch(uint8_t opcode);
+
 public:
     CPU(Bus& _bus) : bus(_bus) {}
 
+    // Interrupt lines, only sampled when an instruction is about to start
+    enum Interrupt {
+        INTERRUPT_NMI = 0x1,    // Vblank edge from the PPU, until it is taken
+        INTERRUPT_IRQ = 0x2     // Held by the mapper until it is acknowledged
+    };
+
     void Clock();
-    void IRQ();
-    void NMI();
+    void Skip(int ncycles);     // Clocks that can't start an instruction
+    // Holds the CPU for ncycles more after the current instruction, while
+    // something else has the bus
+    void Stall(int ncycles) { cycles_rem += ncycles; }
+    void SetInterrupt(uint8_t line, bool active) {
+        if (active)
+            interrupts |= line;
+        else
+            interrupts &= ~line;
+    }
+    uint8_t GetInterrupts() { return interrupts; }
     void Reset();
     void PowerOn();
 
-    void SetAddrMode();
-    void Execute();
-
     std::string DisassembleString(uint16_t addr);
     void DisassembleLog();
     std::array<uint16_t, NUM_INSTR_TO_DISPLAY> GenerateOpStartingAddrs();
 
     uint16_t GetPC();
     void SetPC(uint16_t _pc);
+    void SetPredecode(bool _predecode);
+
+    // Non-zero right after an instruction that closed an idle loop, the
+    // Bus may then skip whole trips around it with SkipIdleLoop
+    int GetIdlePeriod() { return idle_period; }
+    void SkipIdleLoop(uint64_t ntrips);
+    // For reads that went to anything but RAM or ROM
+    void ClearIdleLoop() { idle_pure = false; }
     bool DumpRAM();
     int GetCyclesRem();
 
@@ -19,9 +19,6 @@
 #include <cstdlib>
 #include <cstring>
 
-// FIXME: REPLACE WITH UTIL LOGGING
-#include <iostream>
-
 #include "mappers/Mapper.h"
 #include "PPU.h"
 #include "../Util.h"
@@ -30,7 +27,8 @@ namespace NESCLE {
 bool Cart::LoadROMStr(const char* file_as_str) {
     // FIXME: MAKE THIS TAKE THE LENGTH OF THE FILE IN BYTES
     if (strncmp(file_as_str, "NES\x1a", 4) != 0) {
-        std::cout << "header did not match\n";
+        Util_Log(Util_LogLevel::ERROR, Util_LogCategory::ERROR,
+            "Cart_LoadROMStr: invalid header");
         return false;
     }
     size_t read_pos = 16;
@@ -42,24 +40,30 @@ bool Cart::LoadROMStr(const char* file_as_str) {
 
     file_type = (metadata.mapper2 & 0x0c) == 0x08 ? FileType::NES2 :
         FileType::INES;
-    std::cout << "File Type: " << (int)file_type << "\n";
+    Util_Log(Util_LogLevel::DEBUG, Util_LogCategory::APPLICATION,
+        "Cart_LoadROMStr: file type " + std::to_string((int)file_type));
 
     const size_t prg_rom_nbytes = Cart::GetPrgRomBytes();
-    std::cout << "PRG ROM: " << prg_rom_nbytes << '\n';
+    Util_Log(Util_LogLevel::DEBUG, Util_LogCategory::APPLICATION,
+        "Cart_LoadROMStr: prg_rom bytes " + std::to_string(prg_rom_nbytes));
+    UnmapROM();
     prg_rom.resize(prg_rom_nbytes);
     prg_rom.shrink_to_fit();
+    prg_rom_version++;
 
     memcpy(&prg_rom[0], &file_as_str[read_pos], prg_rom_nbytes);
     read_pos += prg_rom_nbytes;
 
     const size_t chr_rom_nbytes = Cart::GetChrRomBytes();
-    std::cout << "CHR ROM: " << chr_rom_nbytes << '\n';
+    Util_Log(Util_LogLevel::DEBUG, Util_LogCategory::APPLICATION,
+        "Cart_LoadROMStr: chr_rom bytes " + std::to_string(chr_rom_nbytes));
     chr_rom.resize(chr_rom_nbytes);
     chr_rom.shrink_to_fit();
     if (GetChrRomBlocks() > 0) {
         memcpy(&chr_rom[0], &file_as_str[read_pos], chr_rom_nbytes);
         read_pos += chr_rom_nbytes;
     }
+    DecodeChr();
 
     uint8_t mapper_id = (metadata.mapper2 & 0xf0) | (metadata.mapper1 >> 4);
     auto mirror_mode = (metadata.mapper1 & 1) ? Mapper::MirrorMode::VERTICAL
@@ -137,8 +141,10 @@ bool Cart::LoadROM(const char* path) {
     // USE ANY OF THE EXTENDED FEATURES
 
     const size_t prg_rom_nbytes = Cart::GetPrgRomBytes();
+    UnmapROM();
     prg_rom.resize(prg_rom_nbytes);
     prg_rom.shrink_to_fit();
+    prg_rom_version++;
     // FIXME: THIS IS EXTREMELY DANGEROUS AND YOU SHOULD NEVER DO THIS
     rom.read(reinterpret_cast<char*>(&prg_rom[0]), prg_rom_nbytes);
     if (rom.gcount() != static_cast<std::streamsize>(prg_rom_nbytes)) {
@@ -162,6 +168,7 @@ bool Cart::LoadROM(const char* path) {
             return false;
         }
     }
+    DecodeChr();
 
     // Determine mapper_id and mirror_mode
     // mapper_id hi 4 bits is the 4 hi bits of mapper 2 and the lo 4 bits
@@ -227,7 +234,10 @@ uint8_t Cart::ReadPrgRom(size_t off) {
 
 void Cart::WritePrgRom(size_t off, uint8_t val) {
     assert(off < GetPrgRomBytes());
-    prg_rom[off] = val;
+    if (prg_rom[off] != val) {
+        prg_rom[off] = val;
+        prg_rom_version++;
+    }
 }
 
 uint8_t Cart::ReadChrRom(size_t off) {
@@ -238,6 +248,28 @@ uint8_t Cart::ReadChrRom(size_t off) {
 void Cart::WriteChrRom(size_t off, uint8_t val) {
     assert(off < GetChrRomBytes());
     chr_rom[off] = val;
+    DecodeChrRow(off & ~0x8);
+}
+
+// Tiles are 16 bytes, the low bit plane of each row followed 8 bytes later
+// by the high one
+void Cart::DecodeChrRow(size_t off) {
+    ChrRow& row = chr_rows[(off >> 4 << 3) | (off & 7)];
+    row.lo = chr_rom[off];
+    row.hi = chr_rom[off + 8];
+    row.lo_flipped = Util_FlipBits(row.lo);
+    row.hi_flipped = Util_FlipBits(row.hi);
+    for (int i = 0; i < 8; i++)
+        row.pixels[i] = ((row.lo >> (7 - i)) & 1) | (((row.hi >> (7 - i)) & 1) << 1);
+}
+
+// Rebuilds every row, for when chr_rom was replaced as a whole
+void Cart::DecodeChr() {
+    chr_rows.resize(chr_rom.size() / 2);
+    for (size_t tile = 0; tile < chr_rom.size(); tile += 16) {
+        for (size_t y = 0; y < 8; y++)
+            DecodeChrRow(tile + y);
+    }
 }
 
 Mapper* Cart::GetMapper() {
@@ -250,6 +282,17 @@ const std::string& Cart::GetROMPath() {
 
 void Cart::SetMapper(uint8_t _id, Mapper::MirrorMode _mode) {
     mapper = Mapper::CreateMapperFromID(_id, *this, _mode);
+    if (mapper != nullptr) {
+        mapper->UpdateCPUPages();
+        mapper->UpdatePPUPages();
+    }
+}
+
+// Nothing may read through the pages into the ROM about to be replaced.
+// The nametables stay mapped, they belong to the PPU
+void Cart::UnmapROM() {
+    cpu_map.Unmap(0x4000, 0xc000);
+    ppu.GetMemoryMap().Unmap(0x0000, 0x2000);
 }
 
 // Since we need to have the game loaded in order to load a save state, we
@@ -264,5 +307,7 @@ void to_json(nlohmann::json& j, const Cart& cart) {
 
 void from_json(const nlohmann::json& j, Cart& cart) {
     j.at("mapper").get_to(*cart.mapper);
+    // The mapper brings CHR RAM back with it
+    cart.DecodeChr();
 }
 }
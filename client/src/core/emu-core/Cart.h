@@ -16,6 +16,7 @@
 #ifndef CART_H_
 #define CART_H_
 
+#include <cassert>
 #include <cstdint>
 #include <fstream>
 #include <memory>
@@ -24,6 +25,7 @@
 
 #include <nlohmann/json.hpp>
 
+#include "MemoryMap.h"
 #include "mappers/Mapper.h"
 #include "../NESCLETypes.h"
 
@@ -56,14 +58,41 @@ private:
     std::string rom_path;
 
     std::unique_ptr<Mapper> mapper;
+    // Owned by the Bus and the PPU, the mapper points them at the banks it
+    // switches in and the nametables its mirroring selects
+    CPUMemoryMap& cpu_map;
+    PPU& ppu;
 
     std::vector<uint8_t> prg_rom;
     std::vector<uint8_t> chr_rom;
 
+    // Bumped whenever prg_rom changes, so code decoded from it can be dropped
+    uint32_t prg_rom_version = 0;
+
+public:
+    // One row of a CHR tile, decoded so the PPU can fetch it in one go
+    struct ChrRow {
+        uint8_t pixels[8];      // 2 bit pixel indices, left to right
+        uint8_t lo;             // The bit planes as they are stored
+        uint8_t hi;
+        uint8_t lo_flipped;     // The bit planes mirrored, for sprites
+        uint8_t hi_flipped;     // flipped horizontally
+    };
+
+private:
+    // Every row of chr_rom, kept in sync by WriteChrRom. It is indexed by
+    // CHR offset, so bank switches just change which rows the PPU asks for
+    std::vector<ChrRow> chr_rows;
+
+    void DecodeChrRow(size_t off);
+    void UnmapROM();
+
 public:
     static constexpr int CHR_ROM_CHUNK_SIZE = 0x2000;
     static constexpr int PRG_ROM_CHUNK_SIZE = 0x4000;
 
+    Cart(CPUMemoryMap& _cpu_map, PPU& _ppu) : cpu_map(_cpu_map), ppu(_ppu) {}
+
     bool LoadROM(const char* path);
     bool LoadROMStr(const char* file_as_str);
 
@@ -78,12 +107,23 @@ public:
     size_t GetChrRomBytes();
 
     std::vector<uint8_t>& GetChrRomRef() { return chr_rom;}
+    std::vector<uint8_t>& GetPrgRomRef() { return prg_rom; }
+    uint32_t GetPrgRomVersion() { return prg_rom_version; }
+    CPUMemoryMap& GetCPUMap() { return cpu_map; }
+    PPU& GetPPU() { return ppu; }
 
     uint8_t ReadPrgRom(size_t off);
     void WritePrgRom(size_t off, uint8_t data);
     uint8_t ReadChrRom(size_t off);
     void WriteChrRom(size_t off, uint8_t data);
 
+    // off is the CHR offset of the low bit plane of the row
+    const ChrRow& GetChrRow(size_t off) {
+        assert(off < GetChrRomBytes());
+        return chr_rows[(off >> 4 << 3) | (off & 7)];
+    }
+    void DecodeChr();
+
     NLOHMANN_DEFINE_TYPE_INTRUSIVE(ROMHeader, name, prg_rom_size,
         chr_rom_size, mapper1, mapper2, prg_ram_size, tv_system1, tv_system2,
         padding)
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2023 Edward C. Pinkston
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MEMORYMAP_H_
+#define MEMORYMAP_H_
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace NESCLE {
+/*
+ * Page table for an address space of SPACE_SIZE bytes. Each 1kb page either
+ * points straight at the memory behind it, or is null, meaning the access
+ * has to go the slow way (registers, mapper writes, banks the mapper can't
+ * back). Reads and writes are mapped separately so ROM can be read directly
+ * while writes to it still reach the mapper.
+ */
+template <size_t SPACE_SIZE>
+class MemoryMap {
+public:
+    static constexpr int PAGE_BITS = 10;
+    static constexpr size_t PAGE_SIZE = 1 << PAGE_BITS;
+    static constexpr size_t PAGE_COUNT = SPACE_SIZE >> PAGE_BITS;
+
+private:
+    std::array<uint8_t*, PAGE_COUNT> read_pages;
+    std::array<uint8_t*, PAGE_COUNT> write_pages;
+
+public:
+    MemoryMap() { Clear(); }
+
+    void Clear() {
+        read_pages.fill(nullptr);
+        write_pages.fill(nullptr);
+    }
+
+    // Points [addr, addr + size) at mem, or back at the slow path if mem
+    // is null. Writes only go straight to mem if writable is set
+    void Map(uint16_t addr, size_t size, uint8_t* mem, bool writable) {
+        assert(addr % PAGE_SIZE == 0 && size % PAGE_SIZE == 0);
+        assert(addr + size <= SPACE_SIZE);
+        for (size_t i = 0; i < size / PAGE_SIZE; i++) {
+            uint8_t* page = mem != nullptr ? mem + i * PAGE_SIZE : nullptr;
+            read_pages[(addr >> PAGE_BITS) + i] = page;
+            write_pages[(addr >> PAGE_BITS) + i] = writable ? page : nullptr;
+        }
+    }
+
+    void Unmap(uint16_t addr, size_t size) { Map(addr, size, nullptr, false); }
+
+    // addr must already be inside the address space
+    uint8_t* GetReadPage(uint16_t addr) { return read_pages[addr >> PAGE_BITS]; }
+    uint8_t* GetWritePage(uint16_t addr) { return write_pages[addr >> PAGE_BITS]; }
+};
+
+// The CPU sees 64kb, the PPU 16kb (pattern tables, nametables and their
+// mirrors, the palette is handled by the PPU itself)
+using CPUMemoryMap = MemoryMap<0x10000>;
+using PPUMemoryMap = MemoryMap<0x4000>;
+}
+#endif // MEMORYMAP_H_
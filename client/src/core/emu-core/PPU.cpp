@@ -29,32 +29,153 @@
 
 #include <string.h>
 
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
 #include "Bus.h"
 #include "Cart.h"
-#include "mappers/Mapper.h"
+#include "mappers/MapperDispatch.h"
 #include "../Util.h"
 
 namespace NESCLE {
-/* Helper Functions */
-static uint8_t flip_bits(uint8_t x) {
-    // The trivial algorithm is to say if the ith position is set,
-    // then the (7 - i)th bit would be set in the result
-
-    // However, this is a rather clever algorithm from GeeksForGeeks
-    // https://www.geeksforgeeks.org/write-an-efficient-c-program-to-reverse-bits-of-a-number/
-    int count = 7;
-    uint8_t res = x;
-
-    x >>= 1;
-    while (x > 0) {
-        res <<= 1;
-        res |= x & 1;
-        x >>= 1;
-        count--;
+// dst[i] = colors[src[i]] for color indices below 0x40. Each byte of the
+// output colors gets its own 64 entry table, which is looked up 16 entries
+// at a time with byte shuffles, and then the four bytes are interleaved
+// back into pixels
+static void expand_colors(uint32_t* dst, const uint8_t* src, size_t n,
+    const uint32_t* colors) {
+    size_t i = 0;
+
+#if defined(__AVX2__) || defined(__SSSE3__) || defined(__wasm_simd128__)
+    uint8_t tables[4][0x40];
+    for (int c = 0; c < 0x40; c++) {
+        uint8_t bytes[4];
+        memcpy(bytes, &colors[c], sizeof(bytes));
+        for (int b = 0; b < 4; b++)
+            tables[b][c] = bytes[b];
+    }
+#endif
+
+#if defined(__AVX2__)
+    __m256i lut[4][4];
+    for (int b = 0; b < 4; b++) {
+        for (int q = 0; q < 4; q++) {
+            lut[b][q] = _mm256_broadcastsi128_si256(
+                _mm_loadu_si128((const __m128i*)&tables[b][q * 16]));
+        }
     }
 
-    res <<= count;
-    return res;
+    const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+    for (size_t end = n / 32 * 32; i < end; i += 32) {
+        __m256i idx = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(idx, 4), low_nibble);
+
+        __m256i ch[4];
+        for (int b = 0; b < 4; b++) {
+            ch[b] = _mm256_setzero_si256();
+            for (int q = 0; q < 4; q++) {
+                __m256i sel = _mm256_cmpeq_epi8(hi, _mm256_set1_epi8((char)q));
+                ch[b] = _mm256_or_si256(ch[b], _mm256_and_si256(sel,
+                    _mm256_shuffle_epi8(lut[b][q], idx)));
+            }
+        }
+
+        // Unpacks work within each 128-bit lane, so lane 0 ends up with
+        // pixels 0-15 and lane 1 with pixels 16-31
+        __m256i b01lo = _mm256_unpacklo_epi8(ch[0], ch[1]);
+        __m256i b01hi = _mm256_unpackhi_epi8(ch[0], ch[1]);
+        __m256i b23lo = _mm256_unpacklo_epi8(ch[2], ch[3]);
+        __m256i b23hi = _mm256_unpackhi_epi8(ch[2], ch[3]);
+        __m256i p0 = _mm256_unpacklo_epi16(b01lo, b23lo);
+        __m256i p1 = _mm256_unpackhi_epi16(b01lo, b23lo);
+        __m256i p2 = _mm256_unpacklo_epi16(b01hi, b23hi);
+        __m256i p3 = _mm256_unpackhi_epi16(b01hi, b23hi);
+
+        __m256i* out = (__m256i*)(dst + i);
+        _mm256_storeu_si256(out + 0, _mm256_permute2x128_si256(p0, p1, 0x20));
+        _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(p2, p3, 0x20));
+        _mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(p0, p1, 0x31));
+        _mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(p2, p3, 0x31));
+    }
+#elif defined(__SSSE3__)
+    __m128i lut[4][4];
+    for (int b = 0; b < 4; b++) {
+        for (int q = 0; q < 4; q++)
+            lut[b][q] = _mm_loadu_si128((const __m128i*)&tables[b][q * 16]);
+    }
+
+    const __m128i low_nibble = _mm_set1_epi8(0x0f);
+    for (size_t end = n / 16 * 16; i < end; i += 16) {
+        __m128i idx = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(idx, 4), low_nibble);
+
+        __m128i ch[4];
+        for (int b = 0; b < 4; b++) {
+            ch[b] = _mm_setzero_si128();
+            for (int q = 0; q < 4; q++) {
+                __m128i sel = _mm_cmpeq_epi8(hi, _mm_set1_epi8((char)q));
+                ch[b] = _mm_or_si128(ch[b], _mm_and_si128(sel,
+                    _mm_shuffle_epi8(lut[b][q], idx)));
+            }
+        }
+
+        __m128i b01lo = _mm_unpacklo_epi8(ch[0], ch[1]);
+        __m128i b01hi = _mm_unpackhi_epi8(ch[0], ch[1]);
+        __m128i b23lo = _mm_unpacklo_epi8(ch[2], ch[3]);
+        __m128i b23hi = _mm_unpackhi_epi8(ch[2], ch[3]);
+
+        __m128i* out = (__m128i*)(dst + i);
+        _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(b01lo, b23lo));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(b01lo, b23lo));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(b01hi, b23hi));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(b01hi, b23hi));
+    }
+#elif defined(__wasm_simd128__)
+    v128_t lut[4][4];
+    for (int b = 0; b < 4; b++) {
+        for (int q = 0; q < 4; q++)
+            lut[b][q] = wasm_v128_load(&tables[b][q * 16]);
+    }
+
+    for (size_t end = n / 16 * 16; i < end; i += 16) {
+        v128_t idx = wasm_v128_load(src + i);
+
+        // swizzle gives 0 for out of range indices, so each quarter of the
+        // table only answers for its own 16 colors
+        v128_t ch[4];
+        for (int b = 0; b < 4; b++) {
+            ch[b] = wasm_i8x16_splat(0);
+            for (int q = 0; q < 4; q++) {
+                v128_t rel = wasm_i8x16_sub(idx, wasm_i8x16_splat(q * 16));
+                ch[b] = wasm_v128_or(ch[b], wasm_i8x16_swizzle(lut[b][q], rel));
+            }
+        }
+
+        v128_t b01lo = wasm_i8x16_shuffle(ch[0], ch[1],
+            0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+        v128_t b01hi = wasm_i8x16_shuffle(ch[0], ch[1],
+            8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+        v128_t b23lo = wasm_i8x16_shuffle(ch[2], ch[3],
+            0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+        v128_t b23hi = wasm_i8x16_shuffle(ch[2], ch[3],
+            8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+
+        wasm_v128_store(dst + i + 0, wasm_i16x8_shuffle(b01lo, b23lo,
+            0, 8, 1, 9, 2, 10, 3, 11));
+        wasm_v128_store(dst + i + 4, wasm_i16x8_shuffle(b01lo, b23lo,
+            4, 12, 5, 13, 6, 14, 7, 15));
+        wasm_v128_store(dst + i + 8, wasm_i16x8_shuffle(b01hi, b23hi,
+            0, 8, 1, 9, 2, 10, 3, 11));
+        wasm_v128_store(dst + i + 12, wasm_i16x8_shuffle(b01hi, b23hi,
+            4, 12, 5, 13, 6, 14, 7, 15));
+    }
+#endif
+
+    for (; i < n; i++)
+        dst[i] = colors[src[i]];
 }
 
 static void set_loopy_register(uint16_t* reg, uint16_t value,
@@ -113,11 +234,22 @@ static uint16_t align_loopy_register(uint16_t reg, uint16_t bitmask) {
     return ret;
 }
 
-void PPU::ScreenWrite(int x, int y, uint32_t color) {
+void PPU::ScreenWrite(int x, int y, uint8_t color_idx) {
     // Avoids buffer overflow on overscan
     if (y >= RESOLUTION_Y || x >= RESOLUTION_X || x < 0 || y < 0)
         return;
-    screen[y * RESOLUTION_X + x] = color;
+
+    // Palette RAM holds whatever the game wrote, only 6 bits are a color
+    screen[y * RESOLUTION_X + x] = color_idx & 0x3f;
+}
+
+// Converts the finished screen into the output format in one pass
+void PPU::ExpandFrame() {
+    if (output_format == PixelFormat::INDEXED8)
+        memcpy(output, screen, sizeof(screen));
+    else
+        expand_colors((uint32_t*)output, screen, RESOLUTION_X * RESOLUTION_Y,
+            output_colors);
 }
 
 void PPU::LoadBGShifters() {
@@ -340,317 +472,246 @@ PPU::PPU(Bus& _bus) : bus(_bus) {
     PPU* ppu = this;
     Util_MemsetU32((uint32_t*)ppu->sprpatterntbl, 0xff000000,
         sizeof(ppu->sprpatterntbl)/sizeof(uint32_t));
-    Util_MemsetU32((uint32_t*)ppu->screen, 0xff000000,
-        sizeof(ppu->screen)/sizeof(uint32_t));
     Util_MemsetU32((uint32_t*)ppu->frame_buffer, 0xff000000,
         sizeof(ppu->frame_buffer)/sizeof(uint32_t));
+    memset(ppu->screen, 0, sizeof(ppu->screen));
     memset(ppu->palette_overrides, false, sizeof(ppu->palette_overrides));
+    SetOutput(nullptr, PixelFormat::ARGB8888);
+}
+
+void PPU::SetOutput(void* buffer, PixelFormat format) {
+    output = buffer != nullptr ? buffer : frame_buffer;
+    output_format = buffer != nullptr ? format : PixelFormat::ARGB8888;
+
+    for (int i = 0; i < 0x40; i++) {
+        uint32_t argb = MapColor(i);
+        if (output_format == PixelFormat::RGBA8888) {
+            // Stored as a uint32_t, so the byte order depends on the host
+            uint8_t rgba[4] = {
+                (uint8_t)(argb >> 16), (uint8_t)(argb >> 8),
+                (uint8_t)argb, (uint8_t)(argb >> 24)
+            };
+            memcpy(&output_colors[i], rgba, sizeof(rgba));
+        } else {
+            output_colors[i] = argb;
+        }
+    }
+}
+
+size_t PPU::GetPixelSize(PixelFormat format) {
+    return format == PixelFormat::INDEXED8 ? 1 : 4;
 }
 
 /* Interrupts (technically the PPU has no notion of interrupts) */
 // https://www.nesdev.org/wiki/PPU_rendering
-void PPU::Clock() {
+void PPU::FetchBGTile() {
     PPU* ppu = this;
-    // TODO: MAY WANNA DECOUPEL THE FG RENDER FROM THE BG RENDER
-
-    // FIXME: SPRITE 0 COLLLIISION IS NOT FULLY CORRECT
-    //        OR WE HAVE SOME TIMING DESYNC ISSUE, POSSIBLY
-    //        WITH DMA
-    //        BUT WE FREEZE IN MARIO RANDOMLY
-    //        BECAUSE OF SPRITE 0 HITS
-
-    // NES rendered in 340x260p, with many invisible pixels in the
-    // overscan area. NES actually displayed in 256x240p, but many TVs
-    // did not display that full resolution, so many emulators cut off the
-    // top and bottom of the screen
-
-    // Note that a lot of stuff in here will seem weird because cycle 0 is a
-    // dummy cycle
+    uint16_t my_off;
+
+    switch ((ppu->cycle - 1) % 8) {
+    case 0:
+        // Read next tile id
+        // Tile id is read from the nametable, but I only want the
+        // bottom 12 bits, hence the & 0x0fff
+        LoadBGShifters();
+        ppu->bg_next_tile_id = Read(NAMETBL_OFFSET | (ppu->vram_addr & 0x0fff));
+        break;
+    case 2:
+        // Read attribute information (extra tiles at bottom of
+        // nametbl that give color info)
+
+        // Get the nametable bits
+        my_off = ppu->vram_addr & 0x0c00;
+
+        // Keep the top 3 bits of coarse y and x
+        // and put them in the right place
+        my_off |= ((ppu->vram_addr & LOOPY_COARSE_Y) >> 7) << 3;
+        my_off |= ((ppu->vram_addr & LOOPY_COARSE_X) >> 2) << 0;
+
+        // 0x23c0 is the starting address of the attribute memory
+        ppu->bg_next_tile_attr = Read(0x23c0 | my_off);
+
+        // Final info is only 2 bits
+        // Doing some basic arithmetic, we can determine that one byte
+        // in the attribute memory actually coressponds to a group of 4 tiles
+        // we only need 2 bits to represent a color. so we do some arithmetic
+        // to get the appropriate palette for each tile
+        if (((ppu->vram_addr & LOOPY_COARSE_Y) >> 5) & 0x02)
+            ppu->bg_next_tile_attr >>= 4;
+        if (((ppu->vram_addr & LOOPY_COARSE_X) >> 0) & 0x02)
+            ppu->bg_next_tile_attr >>= 2;
+        ppu->bg_next_tile_attr &= 0x03;
 
-    // Prerender and visible scanlines
-    if (ppu->scanline >= -1 && ppu->scanline < PPU::RESOLUTION_Y) {
-        uint16_t my_off;
+        break;
+    case 4:
+        // Get LSB
+        // The control register tells us what half of pattern memory to read from
+        // which is why our bg_next_tile_id is only 8-bits, since it only needs
+        // to cover 256 tiles instead of the whole 512
+        my_off = ((ppu->control & PPU_CTRL_BG_TILE_SELECT) >> 4) << 12;
+        my_off += ((uint16_t)ppu->bg_next_tile_id << 4);
+        my_off += (ppu->vram_addr & LOOPY_FINE_Y) >> 12;
+
+        ppu->bg_next_tile_lsb = Read(my_off);
+        break;
+    case 6:
+        // Get MSB
+        my_off = ((ppu->control & PPU_CTRL_BG_TILE_SELECT) >> 4) << 12;
+        my_off += ((uint16_t)ppu->bg_next_tile_id << 4);
+        my_off += (ppu->vram_addr & LOOPY_FINE_Y) >> 12;
 
-        // Visible cycles and preparation cycles
-        // The numbers here seem really weird, as you would think we would only
-        // be off by 1, but if we started at 1, we would end up ignoring
-        // the loaded bg shifters from the previous scanline loaded in the
-        // horizontal blanking period. Similar logic
-        // applies to the 321, except there we actually do want to load new
-        // shifters, so we start there instead of at 322. Alternatively I'm
-        // wrong and this is a weird quirk of OLC's implementation.
-        // TODO: TEST THE BOUNDARIES HERE WITH A MORE COMPLICATED GAME TO SEE
-        //       IF THERE IS ANY CLIPPING
-        // NOTE: NO PERCIEVED DIFFERENCE BETWEEN USING 1 AND 2 HERE, I WILL
-        //      STICK WITH 2 SINCE THAT IS WHAT OLC HAS
+        ppu->bg_next_tile_msb = Read(my_off + 8);
+        break;
+    case 7:
+        IncrementScrollX();
+        break;
+    }
+}
 
-        // PROBABLY SHOULD BE 1 SINCE VERYTHING ELSE SEEMS TO USE 1
-        if ((ppu->cycle >= 2 && ppu->cycle < 258)
-            || (ppu->cycle >= 321 && ppu->cycle < 338)) {
-            // NOTE: If we move this to the bottom we might only wanna do one cycle
-            // cuz obviously this will get shifted before we did anything if starting
-            // at one
-            UpdateShifters();
+void PPU::EvaluateSprites() {
+    PPU* ppu = this;
+    // Set sprite info to 0xff, because if the y-coord of the sprite
+    // is 0xff, we will never see it
+    memset(ppu->spr_scanline, 0xff, SPR_PER_LINE * sizeof(OAM));
+    ppu->spr_count = 0;
+    ppu->spr0_can_hit = false;
 
-            switch ((ppu->cycle - 1) % 8) {
-            case 0:
-                // Read next tile id
-                // Tile id is read from the nametable, but I only want the
-                // bottom 12 bits, hence the & 0x0fff
-                LoadBGShifters();
-                ppu->bg_next_tile_id = Read(NAMETBL_OFFSET | (ppu->vram_addr & 0x0fff));
-                break;
-            case 2:
-                // Read attribute information (extra tiles at bottom of
-                // nametbl that give color info)
-
-                // Get the nametable bits
-                my_off = ppu->vram_addr & 0x0c00;
-
-                // Keep the top 3 bits of coarse y and x
-                // and put them in the right place
-                my_off |= ((ppu->vram_addr & LOOPY_COARSE_Y) >> 7) << 3;
-                my_off |= ((ppu->vram_addr & LOOPY_COARSE_X) >> 2) << 0;
-
-                // 0x23c0 is the starting address of the attribute memory
-                ppu->bg_next_tile_attr = Read(0x23c0 | my_off);
-
-                // Final info is only 2 bits
-                // Doing some basic arithmetic, we can determine that one byte
-                // in the attribute memory actually coressponds to a group of 4 tiles
-                // we only need 2 bits to represent a color. so we do some arithmetic
-                // to get the appropriate palette for each tile
-                if (((ppu->vram_addr & LOOPY_COARSE_Y) >> 5) & 0x02)
-                    ppu->bg_next_tile_attr >>= 4;
-                if (((ppu->vram_addr & LOOPY_COARSE_X) >> 0) & 0x02)
-                    ppu->bg_next_tile_attr >>= 2;
-                ppu->bg_next_tile_attr &= 0x03;
+    int oam_entry = 0;
 
-                break;
-            case 4:
-                // Get LSB
-                // The control register tells us what half of pattern memory to read from
-                // which is why our bg_next_tile_id is only 8-bits, since it only needs
-                // to cover 256 tiles instead of the whole 512
-                my_off = ((ppu->control & PPU_CTRL_BG_TILE_SELECT) >> 4) << 12;
-                my_off += ((uint16_t)ppu->bg_next_tile_id << 4);
-                my_off += (ppu->vram_addr & LOOPY_FINE_Y) >> 12;
-
-                ppu->bg_next_tile_lsb = Read(my_off);
-                break;
-            case 6:
-                // Get MSB
-                my_off = ((ppu->control & PPU_CTRL_BG_TILE_SELECT) >> 4) << 12;
-                my_off += ((uint16_t)ppu->bg_next_tile_id << 4);
-                my_off += (ppu->vram_addr & LOOPY_FINE_Y) >> 12;
+    // FIXME: WON'T PROPERLY DETECT OVRFLOW
+    while (oam_entry < 64 && ppu->spr_count < 9) {
+        // FIXME: MAYBE NEED TO EXPLICITLY CAST TO SIGNED
+        int diff = ppu->scanline - ppu->oam[oam_entry].y;
 
-                ppu->bg_next_tile_msb = Read(my_off + 8);
-                break;
-            case 7:
-                IncrementScrollX();
-                break;
-            }
-        } else if (ppu->scanline == -1 && ppu->cycle == 1) {
-            // We have hit the top of the screen again, so clear VBLANK
-            ppu->status &= ~PPU_STATUS_VBLANK;
-            ppu->status &= ~PPU_STATUS_SPR_OVERFLOW;
-            ppu->status &= ~PPU_STATUS_SPR_HIT;
+        // Sprites can be 16 or 8px tall depending on the mode
+        if (diff >= 0 && diff < ((ppu->control & PPU_CTRL_SPR_HEIGHT) ? 16 : 8)) {
+            // Hit a sprite that will be visible
 
-            // optimization (maybe?)
-            //ppu->status &= ~(PPU_STATUS_VBLANK | PPU_STATUS_SPR_OVERFLOW
-            //      | PPU_STATUS_SPR_HIT);
+            // FIXME: THIS SHOULD BE 9
+            // If I haven't overflowed sprites, copy this sprite's pixel for the line
+            // from the oam
+            if (ppu->spr_count < 8) {
+                if (oam_entry == 0)
+                    ppu->spr0_can_hit = true;
 
-            for (int i = 0; i < SPR_PER_LINE; i++) {
-                ppu->spr_shifter_pattern_lo[i] = 0;
-                ppu->spr_shifter_pattern_hi[i] = 0;
+                // TODO: Don't use memcpy, it's clearer to do explicitly
+                memcpy(&ppu->spr_scanline[ppu->spr_count], &ppu->oam[oam_entry],
+                    sizeof(OAM));
+                ppu->spr_count++;
             }
         }
-            // There is a weird quirk about the prerender scanline that makes
-            // this cycle get skipped
-        else if (ppu->scanline == 0 && ppu->cycle == 0)
-            ppu->cycle = 1;
-        else if (ppu->scanline == -1 && ppu->cycle >= 280 && ppu->cycle < 305)
-            TransferAddrY();
 
-        // First invisible cycle, increment to next scanline
-        if (ppu->cycle == RESOLUTION_X)
-            IncrementScrollY();
-        // Prepare tiles for next scanline
-        else if (ppu->cycle == RESOLUTION_X + 1) {
-            LoadBGShifters();
-            TransferAddrX();
+        oam_entry++;
+    }
 
-            // May wanna put this in a separate if for readability
-            if (ppu->scanline >= 0) {
-                // Set sprite info to 0xff, because if the y-coord of the sprite
-                // is 0xff, we will never see it
-                memset(ppu->spr_scanline, 0xff, SPR_PER_LINE * sizeof(OAM));
-                ppu->spr_count = 0;
-                ppu->spr0_can_hit = false;
-
-                int oam_entry = 0;
-
-                // FIXME: WON'T PROPERLY DETECT OVRFLOW
-                while (oam_entry < 64 && ppu->spr_count < 9) {
-                    // FIXME: MAYBE NEED TO EXPLICITLY CAST TO SIGNED
-                    int diff = ppu->scanline - ppu->oam[oam_entry].y;
-
-                    // Sprites can be 16 or 8px tall depending on the mode
-                    if (diff >= 0 && diff < ((ppu->control & PPU_CTRL_SPR_HEIGHT) ? 16 : 8)) {
-                        // Hit a sprite that will be visible
-
-                        // FIXME: THIS SHOULD BE 9
-                        // If I haven't overflowed sprites, copy this sprite's pixel for the line
-                        // from the oam
-                        if (ppu->spr_count < 8) {
-                            if (oam_entry == 0)
-                                ppu->spr0_can_hit = true;
-
-                            // TODO: Don't use memcpy, it's clearer to do explicitly
-                            memcpy(&ppu->spr_scanline[ppu->spr_count], &ppu->oam[oam_entry],
-                                sizeof(OAM));
-                            ppu->spr_count++;
-                        }
-                    }
+    // Set sprite overflow flag
+    if (ppu->spr_count > 8)
+        ppu->status |= PPU_STATUS_SPR_OVERFLOW;
+    else
+        ppu->status &= ~PPU_STATUS_SPR_OVERFLOW;
+}
 
-                    oam_entry++;
+void PPU::LoadSpriteShifters() {
+    PPU* ppu = this;
+    for (int i = 0; i < ppu->spr_count; i++) {
+        // FIXME: CLEAN THIS CLUSTERFUCK UP
+        uint8_t spr_pattern_bits_lo, spr_pattern_bits_hi;
+        uint16_t spr_pattern_addr_lo, spr_pattern_addr_hi;
+
+        if (ppu->control & PPU_CTRL_SPR_HEIGHT) {
+            // 16x8
+            if (ppu->spr_scanline[i].attributes & (1 << 7)) {
+                // flipped
+
+                if (ppu->scanline - ppu->spr_scanline[i].y < 8) {
+                    // top
+                    uint16_t pattern_tbl = (ppu->spr_scanline[i].tile_id & 1) << 12;
+                    spr_pattern_addr_lo = pattern_tbl
+                        | (((ppu->spr_scanline[i].tile_id & 0xfe) + 1) << 4)
+                        | (7 - (ppu->scanline - ppu->spr_scanline[i].y) % 8);
+                }
+                else {
+                    // bottom
+                    uint16_t pattern_tbl = (ppu->spr_scanline[i].tile_id & 1) << 12;
+                    spr_pattern_addr_lo = pattern_tbl
+                        | (((ppu->spr_scanline[i].tile_id & 0xfe) + 0) << 4)
+                        | (7 - (ppu->scanline - ppu->spr_scanline[i].y) % 8);
                 }
 
-                // Set sprite overflow flag
-                if (ppu->spr_count > 8)
-                    ppu->status |= PPU_STATUS_SPR_OVERFLOW;
-                else
-                    ppu->status &= ~PPU_STATUS_SPR_OVERFLOW;
-            }
-        }
-        // Dummy reads that shouldn't affect anything (but could maybe due to
-        // reading changing the state)
-        else if (ppu->cycle == 338 || ppu->cycle == 340) {
-            ppu->bg_next_tile_id = Read(NAMETBL_OFFSET | (ppu->vram_addr & 0x0fff));
-
-            // NOTE: THIS IS WHERE THE INACCURACY COMES INTO PLAY (I THINK)
-            // May wanna denest this and make 340 its own if
-            if (ppu->cycle == 340) {
-                for (int i = 0; i < ppu->spr_count; i++) {
-                    // FIXME: CLEAN THIS CLUSTERFUCK UP
-                    uint8_t spr_pattern_bits_lo, spr_pattern_bits_hi;
-                    uint16_t spr_pattern_addr_lo, spr_pattern_addr_hi;
-
-                    if (ppu->control & PPU_CTRL_SPR_HEIGHT) {
-                        // 16x8
-                        if (ppu->spr_scanline[i].attributes & (1 << 7)) {
-                            // flipped
-
-                            if (ppu->scanline - ppu->spr_scanline[i].y < 8) {
-                                // top
-                                uint16_t pattern_tbl = (ppu->spr_scanline[i].tile_id & 1) << 12;
-                                spr_pattern_addr_lo = pattern_tbl
-                                    | (((ppu->spr_scanline[i].tile_id & 0xfe) + 1) << 4)
-                                    | (7 - (ppu->scanline - ppu->spr_scanline[i].y) % 8);
-                            }
-                            else {
-                                // bottom
-                                uint16_t pattern_tbl = (ppu->spr_scanline[i].tile_id & 1) << 12;
-                                spr_pattern_addr_lo = pattern_tbl
-                                    | (((ppu->spr_scanline[i].tile_id & 0xfe) + 0) << 4)
-                                    | (7 - (ppu->scanline - ppu->spr_scanline[i].y) % 8);
-                            }
-
-
-                        }
-                        else {
-                            // not flippped
-
-                            if (ppu->scanline - ppu->spr_scanline[i].y < 8) {
-                                // top
-                                uint16_t pattern_tbl = (ppu->spr_scanline[i].tile_id & 1) << 12;
-                                spr_pattern_addr_lo = pattern_tbl
-                                    | ((ppu->spr_scanline[i].tile_id & 0xfe) << 4)
-                                    | ((ppu->scanline - ppu->spr_scanline[i].y) % 8);
-                            }
-                            else {
-                                // bottom
-                                uint16_t pattern_tbl = (ppu->spr_scanline[i].tile_id & 1) << 12;
-                                spr_pattern_addr_lo = pattern_tbl
-                                    | (((ppu->spr_scanline[i].tile_id & 0xfe) + 1) << 4)
-                                    | ((ppu->scanline - ppu->spr_scanline[i].y) % 8);
-                            }
-                        }
-                    }
-                    else {
-                        // 8x8
-                        if (ppu->spr_scanline[i].attributes & (1 << 7)) {
-                            // flipped
-                            uint16_t pattern_tbl = (ppu->control & PPU_CTRL_SPR_TILE_SELECT) == PPU_CTRL_SPR_TILE_SELECT;
-                            pattern_tbl <<= 12;
-
-                            spr_pattern_addr_lo = pattern_tbl
-                                | (ppu->spr_scanline[i].tile_id << 4)
-                                | (7 - (ppu->scanline - ppu->spr_scanline[i].y));
-                        }
-                        else {
-                            // not flippped
-                            uint16_t pattern_tbl = (ppu->control & PPU_CTRL_SPR_TILE_SELECT) == PPU_CTRL_SPR_TILE_SELECT;
-                            pattern_tbl <<= 12;
-
-                            spr_pattern_addr_lo = pattern_tbl
-                                | (ppu->spr_scanline[i].tile_id << 4)
-                                | (ppu->scanline - ppu->spr_scanline[i].y);
-                        }
-                    }
-
-                    // Recall pixel data is always 8 bytes apart
-                    spr_pattern_addr_hi = spr_pattern_addr_lo + 8;
-                    spr_pattern_bits_lo = Read(spr_pattern_addr_lo);
-                    spr_pattern_bits_hi = Read(spr_pattern_addr_hi);
-
-                    if (ppu->spr_scanline[i].attributes & (1 << 6)) {
-                        // horizontal flipped
-                        spr_pattern_bits_lo = flip_bits(spr_pattern_bits_lo);
-                        spr_pattern_bits_hi = flip_bits(spr_pattern_bits_hi);
-                    }
-
-                    ppu->spr_shifter_pattern_lo[i] = spr_pattern_bits_lo;
-                    ppu->spr_shifter_pattern_hi[i] = spr_pattern_bits_hi;
 
+            }
+            else {
+                // not flippped
+
+                if (ppu->scanline - ppu->spr_scanline[i].y < 8) {
+                    // top
+                    uint16_t pattern_tbl = (ppu->spr_scanline[i].tile_id & 1) << 12;
+                    spr_pattern_addr_lo = pattern_tbl
+                        | ((ppu->spr_scanline[i].tile_id & 0xfe) << 4)
+                        | ((ppu->scanline - ppu->spr_scanline[i].y) % 8);
+                }
+                else {
+                    // bottom
+                    uint16_t pattern_tbl = (ppu->spr_scanline[i].tile_id & 1) << 12;
+                    spr_pattern_addr_lo = pattern_tbl
+                        | (((ppu->spr_scanline[i].tile_id & 0xfe) + 1) << 4)
+                        | ((ppu->scanline - ppu->spr_scanline[i].y) % 8);
                 }
             }
         }
+        else {
+            // 8x8
+            if (ppu->spr_scanline[i].attributes & (1 << 7)) {
+                // flipped
+                uint16_t pattern_tbl = (ppu->control & PPU_CTRL_SPR_TILE_SELECT) == PPU_CTRL_SPR_TILE_SELECT;
+                pattern_tbl <<= 12;
+
+                spr_pattern_addr_lo = pattern_tbl
+                    | (ppu->spr_scanline[i].tile_id << 4)
+                    | (7 - (ppu->scanline - ppu->spr_scanline[i].y));
+            }
+            else {
+                // not flippped
+                uint16_t pattern_tbl = (ppu->control & PPU_CTRL_SPR_TILE_SELECT) == PPU_CTRL_SPR_TILE_SELECT;
+                pattern_tbl <<= 12;
 
-        /* FG RENDERERING */
-        // FIXME: THIS IS CHEATING, ALL OF THE SPRITE STUFF IS SUPPOSED TO HAPPEN IN MANY CYCLES
-        //        BUT FOR EASE OF CODING, WE DO IT IN ONE
-        //        THIS WILL PROBABLY BREAK MANY GAMES *COUGH* BATTLETOADS *COUGH*
-    }
-    // Dummy scanline, do nothing
-    else if (ppu->scanline == PPU::RESOLUTION_Y) {
-
-    } else if (ppu->scanline > PPU::RESOLUTION_Y && ppu->scanline <= 260) {
-        // Enter the VBLANK period and emit an NMI if the control register says to
-        if (ppu->scanline == 241 && ppu->cycle == 1) {
-            ppu->status |= PPU_STATUS_VBLANK;
-            if (ppu->control & PPU_CTRL_NMI)
-                ppu->nmi = true;
-
-            // TODO: see if triple buffering may be beneficial
-            //       we currently use double buffering, which means
-            //       if we manage to lap the renderer, we actually have to
-            //       wait for it to finish
-
-            // This is the point at which we are done rendering the frame,
-            // so we copy the current screen to the frame buffer here
+                spr_pattern_addr_lo = pattern_tbl
+                    | (ppu->spr_scanline[i].tile_id << 4)
+                    | (ppu->scanline - ppu->spr_scanline[i].y);
+            }
+        }
 
-            // Don't want to write to buffer if renderer is still rendering
+        // Recall pixel data is always 8 bytes apart
+        // The decoded row has both bit planes already flipped, but the
+        // sprites left over on the prerender line give garbage addresses
+        // that can point past the pattern tables
+        bool flip = ppu->spr_scanline[i].attributes & (1 << 6);
+        if ((spr_pattern_addr_lo & 0x2008) == 0) {
+            Cart& cart = ppu->bus.GetCart();
+            const Cart::ChrRow& row = cart.GetChrRow(
+                ChrOffset(spr_pattern_addr_lo & 0x1fff));
+            spr_pattern_bits_lo = flip ? row.lo_flipped : row.lo;
+            spr_pattern_bits_hi = flip ? row.hi_flipped : row.hi;
+        } else {
+            spr_pattern_addr_hi = spr_pattern_addr_lo + 8;
+            spr_pattern_bits_lo = Read(spr_pattern_addr_lo);
+            spr_pattern_bits_hi = Read(spr_pattern_addr_hi);
+
+            if (flip) {
+                // horizontal flipped
+                spr_pattern_bits_lo = Util_FlipBits(spr_pattern_bits_lo);
+                spr_pattern_bits_hi = Util_FlipBits(spr_pattern_bits_hi);
+            }
+        }
 
-            // Copy the new frame to the frame_buffer
-            memcpy(ppu->frame_buffer, ppu->screen, sizeof(ppu->screen));
+        ppu->spr_shifter_pattern_lo[i] = spr_pattern_bits_lo;
+        ppu->spr_shifter_pattern_hi[i] = spr_pattern_bits_hi;
 
-        }
-    }
-    else {
-        printf("PPU_Clock: invalid scanline value\n");
     }
+}
 
+uint8_t PPU::RenderPixel() {
+    PPU* ppu = this;
     uint8_t bg_pixel = 0x00;
     uint8_t bg_palette = 0x00;
 
@@ -777,14 +838,328 @@ void PPU::Clock() {
         final_palette = 0;
     }
 
+    return ppu->palette[final_palette * 4 + final_pixel];
+}
+
+void PPU::RenderDot() {
+    PPU* ppu = this;
+    // TODO: MAY WANNA DECOUPEL THE FG RENDER FROM THE BG RENDER
+
+    // FIXME: SPRITE 0 COLLLIISION IS NOT FULLY CORRECT
+    //        OR WE HAVE SOME TIMING DESYNC ISSUE, POSSIBLY
+    //        WITH DMA
+    //        BUT WE FREEZE IN MARIO RANDOMLY
+    //        BECAUSE OF SPRITE 0 HITS
+
+    // NES rendered in 340x260p, with many invisible pixels in the
+    // overscan area. NES actually displayed in 256x240p, but many TVs
+    // did not display that full resolution, so many emulators cut off the
+    // top and bottom of the screen
+
+    // Note that a lot of stuff in here will seem weird because cycle 0 is a
+    // dummy cycle
+
+    // Prerender and visible scanlines
+    if (ppu->scanline >= -1 && ppu->scanline < PPU::RESOLUTION_Y) {
+        // Visible cycles and preparation cycles
+        // The numbers here seem really weird, as you would think we would only
+        // be off by 1, but if we started at 1, we would end up ignoring
+        // the loaded bg shifters from the previous scanline loaded in the
+        // horizontal blanking period. Similar logic
+        // applies to the 321, except there we actually do want to load new
+        // shifters, so we start there instead of at 322. Alternatively I'm
+        // wrong and this is a weird quirk of OLC's implementation.
+        // TODO: TEST THE BOUNDARIES HERE WITH A MORE COMPLICATED GAME TO SEE
+        //       IF THERE IS ANY CLIPPING
+        // NOTE: NO PERCIEVED DIFFERENCE BETWEEN USING 1 AND 2 HERE, I WILL
+        //      STICK WITH 2 SINCE THAT IS WHAT OLC HAS
+
+        // PROBABLY SHOULD BE 1 SINCE VERYTHING ELSE SEEMS TO USE 1
+        if ((ppu->cycle >= 2 && ppu->cycle < 258)
+            || (ppu->cycle >= 321 && ppu->cycle < 338)) {
+            // NOTE: If we move this to the bottom we might only wanna do one cycle
+            // cuz obviously this will get shifted before we did anything if starting
+            // at one
+            UpdateShifters();
+
+            FetchBGTile();
+        } else if (ppu->scanline == -1 && ppu->cycle == 1) {
+            // We have hit the top of the screen again, so clear VBLANK
+            ppu->status &= ~PPU_STATUS_VBLANK;
+            ppu->status &= ~PPU_STATUS_SPR_OVERFLOW;
+            ppu->status &= ~PPU_STATUS_SPR_HIT;
+
+            // optimization (maybe?)
+            //ppu->status &= ~(PPU_STATUS_VBLANK | PPU_STATUS_SPR_OVERFLOW
+            //      | PPU_STATUS_SPR_HIT);
+
+            for (int i = 0; i < SPR_PER_LINE; i++) {
+                ppu->spr_shifter_pattern_lo[i] = 0;
+                ppu->spr_shifter_pattern_hi[i] = 0;
+            }
+        }
+            // There is a weird quirk about the prerender scanline that makes
+            // this cycle get skipped
+        else if (ppu->scanline == 0 && ppu->cycle == 0)
+            ppu->cycle = 1;
+        else if (ppu->scanline == -1 && ppu->cycle >= 280 && ppu->cycle < 305)
+            TransferAddrY();
+
+        // First invisible cycle, increment to next scanline
+        if (ppu->cycle == RESOLUTION_X)
+            IncrementScrollY();
+        // Prepare tiles for next scanline
+        else if (ppu->cycle == RESOLUTION_X + 1) {
+            LoadBGShifters();
+            TransferAddrX();
+
+            // May wanna put this in a separate if for readability
+            if (ppu->scanline >= 0)
+                EvaluateSprites();
+        }
+        // Dummy reads that shouldn't affect anything (but could maybe due to
+        // reading changing the state)
+        else if (ppu->cycle == 338 || ppu->cycle == 340) {
+            ppu->bg_next_tile_id = Read(NAMETBL_OFFSET | (ppu->vram_addr & 0x0fff));
+
+            // NOTE: THIS IS WHERE THE INACCURACY COMES INTO PLAY (I THINK)
+            // May wanna denest this and make 340 its own if
+            if (ppu->cycle == 340)
+                LoadSpriteShifters();
+        }
+
+        /* FG RENDERERING */
+        // FIXME: THIS IS CHEATING, ALL OF THE SPRITE STUFF IS SUPPOSED TO HAPPEN IN MANY CYCLES
+        //        BUT FOR EASE OF CODING, WE DO IT IN ONE
+        //        THIS WILL PROBABLY BREAK MANY GAMES *COUGH* BATTLETOADS *COUGH*
+    }
+    // Dummy scanline, do nothing
+    else if (ppu->scanline == PPU::RESOLUTION_Y) {
+
+    } else if (ppu->scanline > PPU::RESOLUTION_Y && ppu->scanline <= 260) {
+        // Enter the VBLANK period and emit an NMI if the control register says to
+        if (ppu->scanline == 241 && ppu->cycle == 1) {
+            ppu->status |= PPU_STATUS_VBLANK;
+            if (ppu->control & PPU_CTRL_NMI) {
+                ppu->nmi = true;
+                ppu->bus.Signal(Scheduler::Event::NMI);
+            }
+
+            // This is the point at which we are done rendering the frame,
+            // so we convert the screen into the output here
+            ExpandFrame();
+        }
+    }
+    else {
+        printf("PPU_Clock: invalid scanline value\n");
+    }
+
     // We write to cycle-1 because cycle 0 is a dummy cycle
-    ScreenWrite(ppu->cycle-1, ppu->scanline,
-        GetColorFromPalette(final_palette, final_pixel));
+    ScreenWrite(ppu->cycle-1, ppu->scanline, RenderPixel());
+}
+
+// Draws dots 0 to 257 of a visible line in one pass, leaving the PPU exactly
+// as calling RenderDot for each of them would. Only valid if nothing outside
+// the PPU read or changed its state in the meantime, since every register,
+// OAM and mapper access has to see the line drawn up to that dot
+void PPU::RenderScanline() {
+    PPU* ppu = this;
+    bool bg_enable = ppu->mask & PPU_MASK_BG_ENABLE;
+    bool spr_enable = ppu->mask & PPU_MASK_SPR_ENABLE;
+    bool left_clip = !(ppu->mask & PPU_MASK_BG_LEFT_COLUMN_ENABLE)
+        && !(ppu->mask & PPU_MASK_SPR_LEFT_COLUMN_ENABLE);
+    uint8_t* line = &ppu->screen[ppu->scanline * RESOLUTION_X];
+
+    // Lay the sprites fetched at the end of the last line out first. Each
+    // entry is the palette index, bit 5 if the sprite is behind the bg and
+    // bit 6 if it is sprite 0, or 0 where every sprite is transparent.
+    // The lowest slot wins, so go from the highest one down
+    uint8_t fg_line[RESOLUTION_X + TILE_X] = {};
+    if (spr_enable) {
+        for (int i = ppu->spr_count - 1; i >= 0; i--) {
+            const OAM& spr = ppu->spr_scanline[i];
+            uint8_t info = 0x10 | ((spr.attributes & 0x3) << 2)
+                | ((spr.attributes & (1 << 5)) ? 0x20 : 0) | (i == 0 ? 0x40 : 0);
+            for (int px = 0; px < TILE_X; px++) {
+                uint8_t pixel = ((ppu->spr_shifter_pattern_lo[i] >> (7 - px)) & 1)
+                    | (((ppu->spr_shifter_pattern_hi[i] >> (7 - px)) & 1) << 1);
+                if (pixel != 0)
+                    fg_line[spr.x + px] = info | pixel;
+            }
+        }
+    }
+
+    // Background of the line with the palette in bits 2-3, or 0 where it is
+    // transparent. Pixel x is at x + fine_x, as that is how far into the
+    // shifters it gets picked. The first two tiles are already in the
+    // shifters and the rest go in as they are fetched
+    uint8_t bg_line[RESOLUTION_X + 2 * TILE_X];
+    for (int i = 0; i < 2 * TILE_X; i++) {
+        uint16_t bit = 0x8000 >> i;
+        uint8_t pixel = ((ppu->bg_shifter_pattern_lo & bit) != 0)
+            | (((ppu->bg_shifter_pattern_hi & bit) != 0) << 1);
+        uint8_t palette = ((ppu->bg_shifter_attr_lo & bit) != 0)
+            | (((ppu->bg_shifter_attr_hi & bit) != 0) << 1);
+        bg_line[i] = pixel != 0 ? (palette << 2) | pixel : 0;
+    }
+
+    Cart& cart = ppu->bus.GetCart();
+    for (int x = 0; x < RESOLUTION_X; x += TILE_X) {
+        // The shifters move before every dot but the first one, and the
+        // next tile is loaded into them after the move. The first tile id
+        // of the line was already read at the end of the last one
+        if (bg_enable && x > 0) {
+            ppu->bg_shifter_pattern_lo <<= 1;
+            ppu->bg_shifter_pattern_hi <<= 1;
+            ppu->bg_shifter_attr_lo <<= 1;
+            ppu->bg_shifter_attr_hi <<= 1;
+        }
+        if (x > 0) {
+            ppu->cycle = x + 1;
+            FetchBGTile();
+        }
+        ppu->cycle = x + 3;
+        FetchBGTile();
+
+        // Nothing can write CHR until the line is done, so both pattern
+        // fetches come out of one decoded row
+        uint16_t pattern_addr = (((ppu->control & PPU_CTRL_BG_TILE_SELECT) >> 4) << 12)
+            + ((uint16_t)ppu->bg_next_tile_id << 4)
+            + ((ppu->vram_addr & LOOPY_FINE_Y) >> 12);
+        const Cart::ChrRow& row = cart.GetChrRow(ChrOffset(pattern_addr));
+        ppu->bg_next_tile_lsb = row.lo;
+        ppu->bg_next_tile_msb = row.hi;
+
+        uint8_t palette = ppu->bg_next_tile_attr << 2;
+        for (int px = 0; px < TILE_X; px++) {
+            bg_line[x + 2 * TILE_X + px] = row.pixels[px] != 0
+                ? palette | row.pixels[px] : 0;
+        }
+
+        if (bg_enable) {
+            ppu->bg_shifter_pattern_lo <<= TILE_X - 1;
+            ppu->bg_shifter_pattern_hi <<= TILE_X - 1;
+            ppu->bg_shifter_attr_lo <<= TILE_X - 1;
+            ppu->bg_shifter_attr_hi <<= TILE_X - 1;
+        }
+        IncrementScrollX();
+    }
+
+    if (!bg_enable)
+        memset(bg_line, 0, sizeof(bg_line));
+
+    for (int x = 0; x < RESOLUTION_X; x++) {
+        uint8_t bg = bg_line[x + ppu->fine_x];
+        uint8_t fg = fg_line[x];
+        uint8_t color;
+        if (fg == 0) {
+            color = bg;
+        } else if (bg == 0) {
+            color = fg & 0x1f;
+        } else {
+            color = (fg & 0x20) ? bg : (fg & 0x1f);
+            // Same as RenderPixel, no hit in the first 8 pixels
+            if ((fg & 0x40) && ppu->spr0_can_hit && x >= 8)
+                ppu->status |= PPU_STATUS_SPR_HIT;
+        }
+
+        if (left_clip && x < 8)
+            color = 0;
+        line[x] = ppu->palette[color] & 0x3f;
+    }
+    IncrementScrollY();
+
+    // The sprites have been counted down and shifted out on every dot up to
+    // 257, so whatever is left is what dot 257 sees below
+    if (spr_enable) {
+        for (int i = 0; i < ppu->spr_count; i++) {
+            int shift = RESOLUTION_X - ppu->spr_scanline[i].x;
+            ppu->spr_shifter_pattern_lo[i] = shift < 8
+                ? ppu->spr_shifter_pattern_lo[i] << shift : 0;
+            ppu->spr_shifter_pattern_hi[i] = shift < 8
+                ? ppu->spr_shifter_pattern_hi[i] << shift : 0;
+            ppu->spr_scanline[i].x = 0;
+        }
+    }
+
+    // Dot 257 sees the sprites of the next line with what is left in the
+    // shifters, so it can still set the sprite 0 hit
+    ppu->cycle = RESOLUTION_X + 1;
+    if (bg_enable) {
+        ppu->bg_shifter_pattern_lo <<= 1;
+        ppu->bg_shifter_pattern_hi <<= 1;
+        ppu->bg_shifter_attr_lo <<= 1;
+        ppu->bg_shifter_attr_hi <<= 1;
+    }
+    FetchBGTile();
+    LoadBGShifters();
+    TransferAddrX();
+    EvaluateSprites();
+    RenderPixel();
+}
+
+// Dots 258 to 340 of a visible line, which only fetch the start of the next
+// one. The pixels in between only matter for the sprite 0 flags, and 340
+// overwrites those
+void PPU::RenderHBlank() {
+    PPU* ppu = this;
+    for (ppu->cycle = 321; ppu->cycle < 338; ppu->cycle++) {
+        UpdateShifters();
+        FetchBGTile();
+    }
+
+    ppu->bg_next_tile_id = Read(NAMETBL_OFFSET | (ppu->vram_addr & 0x0fff));
+    ppu->cycle = 340;
+    ppu->bg_next_tile_id = Read(NAMETBL_OFFSET | (ppu->vram_addr & 0x0fff));
+    LoadSpriteShifters();
+    RenderPixel();
+}
+
+// Catches a deferred line up to the current dot with the dot by dot path,
+// which then draws the rest of the line
+void PPU::SyncScanline() {
+    PPU* ppu = this;
+    if (ppu->deferred_dot < 0)
+        return;
+
+    int end = ppu->cycle;
+    for (ppu->cycle = ppu->deferred_dot; ppu->cycle < end; ppu->cycle++)
+        RenderDot();
+    ppu->deferred_dot = -1;
+}
+
+void PPU::Clock() {
+    PPU* ppu = this;
+    // Visible lines aren't drawn as we go, we wait until dot 257 to draw the
+    // visible part in one go and until dot 340 for the rest. If anything
+    // outside the PPU needs its state before then, SyncScanline catches up
+    // and the rest of the line is drawn dot by dot
+    if (ppu->cycle == 0 && ppu->scanline >= 0 && ppu->scanline < RESOLUTION_Y)
+        ppu->deferred_dot = 0;
+
+    if (ppu->deferred_dot >= 0) {
+        // Same skipped dot as in RenderDot
+        if (ppu->scanline == 0 && ppu->cycle == 0) {
+            ppu->cycle = 1;
+        } else if (ppu->cycle == RESOLUTION_X + 1) {
+            RenderScanline();
+            ppu->deferred_dot = RESOLUTION_X + 2;
+        } else if (ppu->cycle == 340) {
+            RenderHBlank();
+            ppu->deferred_dot = -1;
+        }
+    } else {
+        RenderDot();
+    }
 
     // Properly increment the cycle and scanline
     if ((ppu->mask & PPU_MASK_BG_ENABLE) || (ppu->mask & PPU_MASK_SPR_ENABLE)) {
         if (ppu->cycle == 260 && ppu->scanline < 240) {
-            ppu->bus.GetCart().GetMapper()->CountdownScanline();
+            Mapper_Dispatch(*bus.GetCart().GetMapper(), [this](auto& mapper) {
+                mapper.CountdownScanline();
+                if (mapper.GetIRQStatus())
+                    bus.Signal(Scheduler::Event::IRQ);
+            });
         }
     }
     ppu->cycle++;
@@ -796,10 +1171,55 @@ void PPU::Clock() {
         if (ppu->scanline > 260) {
             ppu->scanline = -1;
             ppu->frame_complete = true;
+            ppu->bus.Signal(Scheduler::Event::FRAME);
         }
     }
 }
 
+// How many more calls to Clock are certain not to Signal anything. Only the
+// dots that can signal are looked at, not whether they would
+int PPU::GetQuietTicks() {
+    int ticks = 0;
+    int line = scanline;
+    int dot = cycle;
+    while (true) {
+        // Dot 0 of line 0 is skipped, Clock does it together with dot 1
+        if (line == 0 && dot == 0)
+            dot = 1;
+
+        // Mapper scanline counter, vblank NMI and end of frame
+        if (line < RESOLUTION_Y && dot <= 260)
+            return ticks + 260 - dot;
+        if (line == 241 && dot <= 1)
+            return ticks + 1 - dot;
+        if (line == 260)
+            return ticks + 340 - dot;
+
+        ticks += 341 - dot;
+        dot = 0;
+        line++;
+    }
+}
+
+// How many ticks after the current one OAM is guaranteed not to be read,
+// sprites are only evaluated from it at dot 257 of the visible lines
+int PPU::GetOAMQuietTicks() {
+    int ticks = 0;
+    int line = scanline;
+    int dot = cycle;
+    while (true) {
+        if (line == 0 && dot == 0)
+            dot = 1;
+
+        if (line >= 0 && line < RESOLUTION_Y && dot <= RESOLUTION_X + 1)
+            return ticks + RESOLUTION_X + 1 - dot;
+
+        ticks += 341 - dot;
+        dot = 0;
+        line = line == 260 ? -1 : line + 1;
+    }
+}
+
 // https://www.nesdev.org/wiki/PPU_power_up_state
 void PPU::PowerOn() {
     // TODO: INITIALIZE MORE SUTFF TO 0
@@ -815,6 +1235,12 @@ void PPU::PowerOn() {
     ppu->status = 0xc0;
 
     memset(ppu->screen, 0, sizeof(ppu->screen));
+    memset(ppu->output, 0,
+        RESOLUTION_X * RESOLUTION_Y * GetPixelSize(ppu->output_format));
+    memset(ppu->nametbl, 0, sizeof(ppu->nametbl));
+    memset(ppu->palette, 0, sizeof(ppu->palette));
+    memset(ppu->non_overridden_palette, 0, sizeof(ppu->non_overridden_palette));
+    memset(ppu->oam, 0, sizeof(ppu->oam));
 
     // just run the reset for safety
     Reset();
@@ -876,6 +1302,7 @@ void PPU::Reset() {
     // FIXME: could be true
     ppu->frame_complete = false;
     ppu->nmi = false;
+    ppu->deferred_dot = -1;
 
     // most of these are probably unimportant to set
     // TODO: SEE WHAT I ACTUALLY NEED TO RESET
@@ -895,171 +1322,49 @@ void PPU::Reset() {
 
 }
 
+// CHR offset that a pattern table address currently maps to
+size_t PPU::ChrOffset(uint16_t addr) {
+    const uint8_t* page = ppu_map.GetReadPage(addr);
+    if (page == nullptr) {
+        return Mapper_Dispatch(*bus.GetCart().GetMapper(), [addr](auto& mapper) {
+            return mapper.MapPPUAddr(addr);
+        });
+    }
+    return page + addr % PPUMemoryMap::PAGE_SIZE - bus.GetCart().GetChrRomRef().data();
+}
+
 uint8_t PPU::Read(uint16_t addr) {
     // Address can't be more than 16kb
-    PPU* ppu = this;
-    // Bus* bus = ppu->bus;
     addr %= 0x4000;
 
-    // chr rom, vram, palette
-    if (addr >= 0 && addr < 0x2000) {
-        Mapper* mapper = bus.GetCart().GetMapper();
-        return mapper->MapPPURead(addr);
-    }
-    else if (addr >= 0x2000 && addr < 0x4000) {
-        // only 1kb in each half of nametable
-        addr %= 0x1000;
-
-        Mapper::MirrorMode mirror_mode = bus.GetCart().GetMapper()->GetMirrorMode();
-
-        if (mirror_mode == Mapper::MirrorMode::HORIZONTAL) {
-            // see vertical comments for explanation
-            if (addr >= 0 && addr < 0x800)
-                return ppu->nametbl[0][addr % 0x400];
-            else if (addr >= 0x800 && addr < 0x1000)
-                return ppu->nametbl[1][addr % 0x400];
-
-        }
-        else if (mirror_mode == Mapper::MirrorMode::VERTICAL) {
-            // notice how two different address ranges map to the same thing
-            // this is because each of the two nametables each contain 1kb of data
-            // and we mirror vertically for the remaining parts of the address range
-            if (addr >= 0 && addr < 0x400)
-                return ppu->nametbl[0][addr % 0x400];
-            else if (addr >= 0x400 && addr < 0x800)
-                return ppu->nametbl[1][addr % 0x400];
-            else if (addr >= 0x800 && addr < 0xc00)
-                return ppu->nametbl[0][addr % 0x400];
-            else if (addr >= 0xc00 && addr < 0x1000)
-                return ppu->nametbl[1][addr % 0x400];
-        }
-        else if (mirror_mode == Mapper::MirrorMode::ONESCREEN_LO) {
-            return ppu->nametbl[0][addr % 0x400];
-        }
-        else if (mirror_mode == Mapper::MirrorMode::ONESCREEN_HI) {
-            return ppu->nametbl[1][addr % 0x400];
-        }
-        else {
-            printf("INVALID MIRROR MODE\n");
-        }
-    }
-    /*
-    else if (addr >= 0x3f00 && addr < 0x4000) {
-        // only 32 colors
-        // we also have mirroring going on top of that for the last pixel transparency effect
-        addr %= 32;
-
-        switch (addr) {
-        case 0x10:
-            addr = 0x00;
-            break;
-        case 0x14:
-            addr = 0x04;
-            break;
-        case 0x18:
-            addr = 0x08;
-            break;
-        case 0x1c:
-            addr = 0x0c;
-            break;
-        }
-
-        // FIXME: MAY BREAK SOME STUFF
-        // palette read also reads vram into the data buffer
-        // but we also must prevent infinite recursion
-        // FIXME: FAILS TO PASS TEST PROBABYL BECAUSE I STILL NEED TO DO THIS
-        // EVEN WITH THESE ADDRESSES
-        // FIXME: TRY HARD CODING IT FOR THE PALETTE READ CASE
-        // FIXME: DOESN'T WORK, THINKS I'M CHANGING THE DATA BUFFER ON A
-        //        PALETTE WRITE EVEN THOUGH THIS IS READ FUNCTION
-
-        if (ppu->vram_addr < 0x3f00 || ppu->vram_addr >= 0x4000)
-            PPU_Read(ppu, ppu->vram_addr);
-        else {
-            uint16_t addr2 = ppu->vram_addr % 32;
-            switch (addr2) {
-            case 0x10:
-                addr2 = 0;
-                break;
-            case 0x14:
-                addr2 = 4;
-                break;
-            case 0x18:
-                addr2 = 8;
-                break;
-            case 0x1c:
-                addr2 = 0x0c;
-                break;
-            }
-
-            ppu->data_buffer = ppu->palette[addr2];
-        }
-
-        return ppu->palette[addr] & ((ppu->mask & PPU_MASK_GREYSCALE) ? 0x30 : 0x3f);
-    }*/
+    // chr rom and vram, 0x3000 to 0x3fff mirrors the nametables
+    const uint8_t* page = ppu_map.GetReadPage(addr);
+    if (page != nullptr)
+        return page[addr % PPUMemoryMap::PAGE_SIZE];
 
-    // FIXME: I WOULDN'T BE SURPRISED IF THIS BREAKS SOMETHING THAT ASSUMES RAM DEFAULT VAL OF 0
-    return 0xff;
+    // Only pattern banks the cart can't back are left unmapped
+    return Mapper_Dispatch(*bus.GetCart().GetMapper(), [addr](auto& mapper) {
+        return mapper.MapPPURead(addr);
+    });
 }
 
 bool PPU::Write(uint16_t addr, uint8_t data) {
     PPU* ppu = this;
-    // Bus* bus = ppu->bus;
     addr %= 0x4000;
 
     // chr rom, vram, palette
-    if (addr >= 0 && addr < 0x2000) {
-        Mapper* mapper = bus.GetCart().GetMapper();
-        return mapper->MapPPUWrite(addr, data);
-    }
-    else if (addr >= 0x2000 && addr < 0x3f00) {
-        //printf("writing to naemtable\n");
-        // only 1kb in each half of nametable
-        addr %= 0x1000;
-
-        Mapper::MirrorMode mirror_mode = bus.GetCart().GetMapper()->GetMirrorMode();
-        //printf("writing nametable\n");
-        if (mirror_mode == Mapper::MirrorMode::HORIZONTAL) {
-            if (addr >= 0 && addr < 0x800) {
-                ppu->nametbl[0][addr % 0x400] = data;
-                return true;
-            }
-            else if (addr >= 0x800 && addr < 0x1000) {
-                //printf("writing to naemtable1\n");
-                ppu->nametbl[1][addr % 0x400] = data;
-                return true;
-            }
-        }
-        else if (mirror_mode == Mapper::MirrorMode::VERTICAL) {
-            if (addr >= 0 && addr < 0x400) {
-                ppu->nametbl[0][addr % 0x400] = data;
-                return true;
-            }
-            else if (addr >= 0x400 && addr < 0x800) {
-                ppu->nametbl[1][addr % 0x400] = data;
-                return true;
-            }
-            else if (addr >= 0x800 && addr < 0xc00) {
-                ppu->nametbl[0][addr % 0x400] = data;
-                return true;
-            }
-            else if (addr >= 0xc00 && addr < 0x1000) {
-                ppu->nametbl[1][addr % 0x400] = data;
-                return true;
-            }
-        }
-        else if (mirror_mode == Mapper::MirrorMode::ONESCREEN_LO) {
-            ppu->nametbl[0][addr % 0x400] = data;
+    if (addr < 0x3f00) {
+        uint8_t* page = ppu_map.GetWritePage(addr);
+        if (page != nullptr) {
+            page[addr % PPUMemoryMap::PAGE_SIZE] = data;
             return true;
         }
-        else if (mirror_mode == Mapper::MirrorMode::ONESCREEN_HI) {
-            ppu->nametbl[1][addr % 0x400] = data;
-            return true;
-        }
-        else {
-            printf("INVALID MIRROR MODE\n");
-            return false;
-        }
+
+        // CHR always goes through the mapper, which keeps the decoded rows
+        // up to date
+        return Mapper_Dispatch(*bus.GetCart().GetMapper(), [addr, data](auto& mapper) {
+            return mapper.MapPPUWrite(addr, data);
+        });
     }
     else if (addr >= 0x3f00 && addr < 0x4000) {
         // only 32 colors
@@ -1094,6 +1399,16 @@ uint8_t PPU::RegisterRead(uint16_t addr) {
     uint8_t tmp = 0xff;
     addr %= 8;
 
+    // Only the status and data ports see what rendering has done so far.
+    // Games poll the status for sprite 0 all the time, so a deferred line
+    // is kept when nothing up to dot 257 can change the bits read
+    bool status_settled = ppu->deferred_dot != 0
+        || (ppu->status & PPU_STATUS_SPR_HIT) || !ppu->spr0_can_hit
+        || !(ppu->mask & PPU_MASK_BG_ENABLE)
+        || !(ppu->mask & PPU_MASK_SPR_ENABLE);
+    if (addr == 7 || (addr == 2 && !status_settled))
+        SyncScanline();
+
     switch (addr) {
     case 0: // control
         tmp = ppu->control;
@@ -1161,6 +1476,8 @@ uint8_t PPU::RegisterRead(uint16_t addr) {
 bool PPU::RegisterWrite(uint16_t addr, uint8_t data) {
     PPU* ppu = this;
     addr %= 8;
+
+    SyncScanline();
     switch (addr) {
     case 0: // control
         ppu->control = data;
@@ -1275,10 +1592,17 @@ void PPU::ClearNMIStatus() {
 }
 
 void PPU::WriteOAM(uint8_t addr, uint8_t data) {
+    SyncScanline();
     auto oam_ptr = reinterpret_cast<uint8_t*>(oam);
     oam_ptr[addr] = data;
 }
 
+// Replaces all of OAM at once. Unlike WriteOAM this doesn't catch up the
+// scanline, the caller must check GetOAMQuietTicks first
+void PPU::CopyOAM(const uint8_t* data) {
+    memcpy(oam, data, sizeof(oam));
+}
+
 bool PPU::GetFrameComplete() {
     return frame_complete;
 }
@@ -1337,6 +1661,8 @@ void to_json(nlohmann::json& j, const PPU& ppu) {
 
         {"nmi", ppu.nmi},
         {"frame_complete", ppu.frame_complete},
+        // A deferred line still holds the state from before deferred_dot
+        {"deferred_dot", ppu.deferred_dot},
     };
 }
 
@@ -1375,6 +1701,7 @@ void from_json(const nlohmann::json& j, PPU& ppu) {
 
     j.at("nmi").get_to(ppu.nmi);
     j.at("frame_complete").get_to(ppu.frame_complete);
+    j.at("deferred_dot").get_to(ppu.deferred_dot);
 
 }
 }
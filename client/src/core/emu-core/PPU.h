@@ -22,6 +22,7 @@
 
 #include <nlohmann/json.hpp>
 
+#include "MemoryMap.h"
 #include "../NESCLETypes.h"
 
 namespace NESCLE {
@@ -38,6 +39,13 @@ public:
     static constexpr int RESOLUTION_X = 256;
     static constexpr int RESOLUTION_Y = 240;
 
+    // Layouts the PPU can write its output in
+    enum class PixelFormat : uint8_t {
+        ARGB8888,   // One uint32_t per pixel, 0xAARRGGBB (SDL style)
+        RGBA8888,   // Bytes R, G, B, A in memory (canvas ImageData)
+        INDEXED8    // One byte per pixel, the 6-bit NES color index
+    };
+
     // FIXME: MAKE PRIVATE
     // Some fields of the loopy registers use multiple bits, so we use these
     // bitmasks to access them
@@ -92,14 +100,23 @@ private:
 
     Bus& bus;
 
-    // Current screen and last complete frame
+    // Current screen as NES color indices, one byte per pixel. At the start
+    // of vblank it is converted into the output, which then holds the
+    // complete frame whenever frame_complete is set
     // We represent them as 1D arrays instead of 2D, because
     // when we want to copy the frame buffer to an SDL_Texture
     // it expects the pixels as linear arrays
-    uint32_t screen[RESOLUTION_Y * RESOLUTION_X];
+    uint8_t screen[RESOLUTION_Y * RESOLUTION_X];
     uint32_t frame_buffer[RESOLUTION_Y * RESOLUTION_X];
 
+    // Where pixels go, frame_buffer unless the caller supplied a buffer
+    void* output;
+    PixelFormat output_format;
+    uint32_t output_colors[0x40];   // NES color index to output_format
+
     uint8_t nametbl[2][NAMETBL_SIZE];   // nes supported 2, 1kb nametables
+    // Pattern table and nametable pages, kept up to date by the mapper
+    PPUMemoryMap ppu_map;
     // std::array<std::array<uint8_t, NAMETBL_SIZE>, 2> nametbl;
     // MAY ADD THIS BACK LATER, BUT FOR NOW THIS IS USELESS
     //uint8_t patterntbl[2][PPU_PATTERNTBL_SIZE];     // nes supported 2, 4k pattern tables
@@ -162,13 +179,27 @@ private:
     bool frame_complete;
     bool nmi;
 
-    void ScreenWrite(int x, int y, uint32_t color);
+    // First dot of the current line that hasn't been drawn yet while it is
+    // held back for RenderScanline, -1 when drawing dot by dot
+    int deferred_dot;
+
+    void ScreenWrite(int x, int y, uint8_t color_idx);
+    void ExpandFrame();
     void LoadBGShifters();
     void UpdateShifters();
     void IncrementScrollX();
     void IncrementScrollY();
     void TransferAddrX();
     void TransferAddrY();
+    void FetchBGTile();
+    void EvaluateSprites();
+    void LoadSpriteShifters();
+    uint8_t RenderPixel();
+    void RenderDot();
+    void RenderScanline();
+    void RenderHBlank();
+
+    size_t ChrOffset(uint16_t addr);
 
     void WriteToSprPatternTbl(int idx, uint8_t palette, int tile, int x, int y);
 
@@ -178,6 +209,9 @@ public:
     PPU(Bus& _bus);
 
     void Clock();
+    void SyncScanline();
+    int GetQuietTicks();
+    int GetOAMQuietTicks();
     void Reset();
     void PowerOn();
 
@@ -198,9 +232,18 @@ public:
     void ClearFrameComplete();
 
     void WriteOAM(uint8_t addr, uint8_t data);
+    void CopyOAM(const uint8_t* data);
 
     uint32_t* GetFramebuffer();
 
+    PPUMemoryMap& GetMemoryMap() { return ppu_map; }
+    uint8_t* GetNametable(int idx) { return nametbl[idx]; }
+
+    // Makes the PPU draw into buffer, which must hold a whole frame in
+    // format. A null buffer goes back to the internal ARGB frame buffer
+    void SetOutput(void* buffer, PixelFormat format);
+    static size_t GetPixelSize(PixelFormat format);
+
     NLOHMANN_DEFINE_TYPE_INTRUSIVE(OAM, y, tile_id, attributes, x)
 
     friend void to_json(nlohmann::json& j, const PPU& ppu);
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2023 Edward C. Pinkston
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <array>
+#include <cstdint>
+
+namespace NESCLE {
+/*
+ * Keeps track of the next master clock tick at which each component has
+ * something to do. The Bus only has to stop and look at the rest of the
+ * system when the clock reaches GetNextTime(); every other tick is just
+ * the PPU advancing.
+ */
+class Scheduler {
+public:
+    // Events due on the same tick are handled in this order
+    enum class Event : uint8_t {
+        CPU,        // CPU starts an instruction or performs a DMA cycle
+        NMI,        // PPU entered vblank with NMIs enabled
+        IRQ,        // Mapper IRQ line went active
+        FRAME,      // PPU finished a frame
+        COUNT
+    };
+
+    static constexpr uint64_t NEVER = UINT64_MAX;
+
+private:
+    std::array<uint64_t, (int)Event::COUNT> times;
+    uint64_t next_time;
+    Event next;
+
+    void UpdateNext() {
+        next_time = NEVER;
+        next = Event::COUNT;
+        for (int i = 0; i < (int)Event::COUNT; i++) {
+            if (times[i] < next_time) {
+                next_time = times[i];
+                next = (Event)i;
+            }
+        }
+    }
+
+public:
+    Scheduler() { Clear(); }
+
+    void Clear() {
+        times.fill(NEVER);
+        next_time = NEVER;
+        next = Event::COUNT;
+    }
+
+    void Schedule(Event event, uint64_t time) {
+        times[(int)event] = time;
+        UpdateNext();
+    }
+
+    void Cancel(Event event) { Schedule(event, NEVER); }
+
+    uint64_t GetTime(Event event) { return times[(int)event]; }
+    uint64_t GetNextTime() { return next_time; }
+    Event GetNext() { return next; }
+};
+}
+#endif // SCHEDULER_H_
@@ -16,6 +16,7 @@
 #include "Mapper.h"
 
 #include "../Cart.h"
+#include "../PPU.h"
 
 #include "Mapper000.h"
 #include "Mapper001.h"
@@ -60,6 +61,51 @@ Mapper::CreateMapperFromID(uint8_t id, Cart& cart, MirrorMode mirror_mode) {
     return mapper;
 }
 
+void Mapper::MapPrgRom(uint16_t addr, size_t size, size_t off) {
+    std::vector<uint8_t>& prg_rom = cart.GetPrgRomRef();
+    if (off + size <= prg_rom.size())
+        cart.GetCPUMap().Map(addr, size, prg_rom.data() + off, false);
+    else
+        cart.GetCPUMap().Unmap(addr, size);
+}
+
+void Mapper::MapPrgRam(uint16_t addr, size_t size, uint8_t* mem) {
+    cart.GetCPUMap().Map(addr, size, mem, true);
+}
+
+void Mapper::MapChr(uint16_t addr, size_t size, size_t off) {
+    std::vector<uint8_t>& chr_rom = cart.GetChrRomRef();
+    PPUMemoryMap& ppu_map = cart.GetPPU().GetMemoryMap();
+    if (off + size <= chr_rom.size())
+        ppu_map.Map(addr, size, chr_rom.data() + off, false);
+    else
+        ppu_map.Unmap(addr, size);
+}
+
+void Mapper::MapNametables() {
+    // Which nametable each 1kb quarter of 0x2000 to 0x2fff shows
+    static constexpr int layouts[4][4] = {
+        { 0, 0, 1, 1 },     // HORIZONTAL
+        { 0, 1, 0, 1 },     // VERTICAL
+        { 0, 0, 0, 0 },     // ONESCREEN_LO
+        { 1, 1, 1, 1 }      // ONESCREEN_HI
+    };
+
+    PPU& ppu = cart.GetPPU();
+    for (int i = 0; i < 4; i++) {
+        uint8_t* nametbl = ppu.GetNametable(layouts[(int)mirror_mode][i]);
+        // 0x3000 to 0x3fff is a mirror of 0x2000 to 0x2fff
+        ppu.GetMemoryMap().Map(0x2000 + i * 0x400, 0x400, nametbl, true);
+        ppu.GetMemoryMap().Map(0x3000 + i * 0x400, 0x400, nametbl, true);
+    }
+}
+
+// Most mappers can't switch CHR
+void Mapper::UpdatePPUPages() {
+    MapChr(0x0000, 0x2000, 0);
+    MapNametables();
+}
+
 void Mapper::ToJSON(nlohmann::json& json) const {
     json["id"] = id;
     json["mirror_mode"] = mirror_mode;
@@ -85,5 +131,7 @@ void to_json(nlohmann::json& json, const Mapper& mapper) {
 
 void from_json(const nlohmann::json& json, Mapper& mapper) {
     mapper.FromJSON(json);
+    mapper.UpdateCPUPages();
+    mapper.UpdatePPUPages();
 }
 }
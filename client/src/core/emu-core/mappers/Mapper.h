@@ -45,6 +45,15 @@ protected:
     virtual void ToJSON(nlohmann::json& json) const;
     virtual void FromJSON(const nlohmann::json& json);
 
+    // Point the CPU pages [addr, addr + size) at PRG ROM offset off, or at
+    // some of the mapper's own RAM. Banks that run past the end of the ROM
+    // are left to MapCPURead
+    void MapPrgRom(uint16_t addr, size_t size, size_t off);
+    void MapPrgRam(uint16_t addr, size_t size, uint8_t* mem);
+    // The same for the pattern tables, and the nametables for mirror_mode
+    void MapChr(uint16_t addr, size_t size, size_t off);
+    void MapNametables();
+
 public:
     static std::unique_ptr<Mapper>
     CreateMapperFromID(uint8_t id, Cart& cart, MirrorMode mirror_mode);
@@ -57,10 +66,18 @@ public:
 
     virtual void Reset() {}
 
+    // Brings the CPU pages in line with the current PRG banks. Every
+    // mapper calls it whenever it switches them
+    virtual void UpdateCPUPages() {}
+    // The same for the PPU pages, whenever the CHR banks or mirroring change
+    virtual void UpdatePPUPages();
+
     virtual uint8_t MapCPURead(uint16_t addr) = 0;
     virtual bool MapCPUWrite(uint16_t addr, uint8_t data) = 0;
     virtual uint8_t MapPPURead(uint16_t addr) = 0;
     virtual bool MapPPUWrite(uint16_t addr, uint8_t data) = 0;
+    // CHR offset that a pattern table address currently maps to
+    virtual size_t MapPPUAddr(uint16_t addr) { return addr; }
 
     virtual void CountdownScanline() {}
     virtual bool GetIRQStatus() { return false; }
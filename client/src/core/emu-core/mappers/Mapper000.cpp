@@ -19,6 +19,17 @@
 #include "../Cart.h"
 
 namespace NESCLE {
+void Mapper000::Reset() {
+    UpdateCPUPages();
+    UpdatePPUPages();
+}
+
+void Mapper000::UpdateCPUPages() {
+    // A lone 16kb bank is mirrored into 0xc000
+    MapPrgRom(0x8000, 0x4000, 0);
+    MapPrgRom(0xc000, 0x4000, cart.GetPrgRomBlocks() > 1 ? 0x4000 : 0);
+}
+
 uint8_t Mapper000::MapCPURead(uint16_t addr) {
     addr %= cart.GetPrgRomBlocks() > 1 ? 0x8000 : 0x4000;
     return cart.ReadPrgRom(addr);
@@ -20,11 +20,14 @@
 #include "Mapper.h"
 
 namespace NESCLE {
-class Mapper000 : public Mapper {
+class Mapper000 final : public Mapper {
 public:
     Mapper000(uint8_t id, Cart& cart, Mapper::MirrorMode mirror)
         : Mapper(id, cart, mirror) {}
 
+    void Reset() override;
+    void UpdateCPUPages() override;
+
     uint8_t MapCPURead(uint16_t addr) override;
     bool MapCPUWrite(uint16_t addr, uint8_t data) override;
     uint8_t MapPPURead(uint16_t addr) override;
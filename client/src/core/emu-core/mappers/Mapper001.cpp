@@ -69,6 +69,34 @@ void Mapper001::Reset() {
     load_reg_ct = 0;
 
     mirror_mode = Mapper::MirrorMode::HORIZONTAL;
+    UpdateCPUPages();
+    UpdatePPUPages();
+}
+
+void Mapper001::UpdatePPUPages() {
+    if (cart.GetChrRomBlocks() == 0) {
+        MapChr(0x0000, 0x2000, 0);
+    } else if (ctrl & 0x10) {
+        // 4kb mode
+        MapChr(0x0000, 0x1000, chr_select4_lo * 0x1000);
+        MapChr(0x1000, 0x1000, chr_select4_hi * 0x1000);
+    } else {
+        // 8kb mode
+        MapChr(0x0000, 0x2000, chr_select8 * 0x2000);
+    }
+    MapNametables();
+}
+
+void Mapper001::UpdateCPUPages() {
+    MapPrgRam(0x6000, 0x2000, sram.data());
+    if (ctrl & 8) {
+        // 16k
+        MapPrgRom(0x8000, 0x4000, prg_select16_lo * 0x4000);
+        MapPrgRom(0xc000, 0x4000, prg_select16_hi * 0x4000);
+    } else {
+        // 32k
+        MapPrgRom(0x8000, 0x8000, prg_select32 * 0x8000);
+    }
 }
 
 uint8_t Mapper001::MapCPURead(uint16_t addr) {
@@ -157,20 +185,27 @@ bool Mapper001::MapCPUWrite(uint16_t addr, uint8_t data) {
         }
     }
 
+    // Both a reset and a finished load can change the banking
+    UpdateCPUPages();
+    UpdatePPUPages();
     return true;
 }
 
 uint8_t Mapper001::MapPPURead(uint16_t addr) {
+    return cart.ReadChrRom(MapPPUAddr(addr));
+}
+
+size_t Mapper001::MapPPUAddr(uint16_t addr) {
     if (cart.GetChrRomBlocks() == 0)
-        return cart.ReadChrRom(addr);
+        return addr;
 
     if (ctrl & 0x10) {
         // 4kb mode
         uint8_t select = addr >= 0x1000 ? chr_select4_hi : chr_select4_lo;
-        return cart.ReadChrRom(select * 0x1000 + (addr % 0x1000));
+        return select * 0x1000 + (addr % 0x1000);
     } else {
         // 8kb mode
-        return cart.ReadChrRom(chr_select8 * 0x2000 + (addr % 0x2000));
+        return chr_select8 * 0x2000 + (addr % 0x2000);
     }
 }
 
@@ -21,7 +21,7 @@
 #include "Mapper.h"
 
 namespace NESCLE {
-class Mapper001 : public Mapper {
+class Mapper001 final : public Mapper {
 private:
     uint8_t chr_select4_lo = 0;
     uint8_t chr_select4_hi = 0;
@@ -41,7 +41,7 @@ private:
 
     // Since we may not know what the size of the prg ram is from
     // the iNES header, we must allocate the maximum possible amount of 32kb
-    std::array<uint8_t, 0x8000> sram;
+    std::array<uint8_t, 0x8000> sram{};
 
 protected:
     void ToJSON(nlohmann::json& json) const override;
@@ -52,10 +52,13 @@ public:
         : Mapper(id, cart, mirror) {}
 
     void Reset() override;
+    void UpdateCPUPages() override;
+    void UpdatePPUPages() override;
 
     uint8_t MapCPURead(uint16_t addr) override;
     bool MapCPUWrite(uint16_t addr, uint8_t data) override;
     uint8_t MapPPURead(uint16_t addr) override;
+    size_t MapPPUAddr(uint16_t addr) override;
     bool MapPPUWrite(uint16_t addr, uint8_t data) override;
 };
 }
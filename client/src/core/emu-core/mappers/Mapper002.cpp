@@ -30,6 +30,13 @@ void Mapper002::FromJSON(const nlohmann::json& json) {
 
 void Mapper002::Reset() {
     bank_select = 0;
+    UpdateCPUPages();
+    UpdatePPUPages();
+}
+
+void Mapper002::UpdateCPUPages() {
+    MapPrgRom(0x8000, 0x4000, (size_t)(bank_select & 0x0f) << 14);
+    MapPrgRom(0xc000, 0x4000, (cart.GetPrgRomBlocks() - 1) * 0x4000);
 }
 
 uint8_t Mapper002::MapCPURead(uint16_t addr) {
@@ -57,6 +64,7 @@ uint8_t Mapper002::MapCPURead(uint16_t addr) {
 
 bool Mapper002::MapCPUWrite(uint16_t addr, uint8_t data) {
     bank_select = data;
+    UpdateCPUPages();
     return true;
 }
 
@@ -20,6 +20,19 @@
 namespace NESCLE {
 void Mapper003::Reset() {
     bank_select = 0;
+    UpdateCPUPages();
+    UpdatePPUPages();
+}
+
+void Mapper003::UpdateCPUPages() {
+    // A lone 16kb bank is mirrored into 0xc000
+    MapPrgRom(0x8000, 0x4000, 0);
+    MapPrgRom(0xc000, 0x4000, cart.GetPrgRomBlocks() > 1 ? 0x4000 : 0);
+}
+
+void Mapper003::UpdatePPUPages() {
+    MapChr(0x0000, 0x2000, (size_t)(bank_select & 0x03) << 13);
+    MapNametables();
 }
 
 uint8_t Mapper003::MapCPURead(uint16_t addr) {
@@ -29,17 +42,22 @@ uint8_t Mapper003::MapCPURead(uint16_t addr) {
 
 bool Mapper003::MapCPUWrite(uint16_t addr, uint8_t data) {
     bank_select = data;
+    UpdatePPUPages();
     return true;
 }
 
 uint8_t Mapper003::MapPPURead(uint16_t addr) {
+    return cart.ReadChrRom(MapPPUAddr(addr));
+}
+
+size_t Mapper003::MapPPUAddr(uint16_t addr) {
     // Only care abt bottom 2 bits
     uint8_t select = bank_select & 0x03;
 
     // Without selection, we can only address from 0 to 0x1fff, which is 13
     // bits. Therefore to determine the bank, we must examine the 14th and
     // 15th bits
-    return cart.ReadChrRom((size_t)((select << 13) | addr));
+    return (size_t)((select << 13) | addr);
 }
 
 bool Mapper003::MapPPUWrite(uint16_t addr, uint8_t data) {
@@ -48,6 +48,20 @@ void Mapper004::Reset() {
     prg_banks[1] = 0x2000;
     prg_banks[2] = (cart.GetPrgRomBlocks() * 2 - 2) * 0x2000;
     prg_banks[3] = (cart.GetPrgRomBlocks() * 2 - 1) * 0x2000;
+    UpdateCPUPages();
+    UpdatePPUPages();
+}
+
+void Mapper004::UpdateCPUPages() {
+    MapPrgRam(0x6000, 0x2000, sram.data());
+    for (int i = 0; i < 4; i++)
+        MapPrgRom(0x8000 + i * 0x2000, 0x2000, prg_banks[i]);
+}
+
+void Mapper004::UpdatePPUPages() {
+    for (int i = 0; i < 8; i++)
+        MapChr(i * 0x400, 0x400, chr_banks[i]);
+    MapNametables();
 }
 
 uint8_t Mapper004::MapCPURead(uint16_t addr) {
@@ -106,6 +120,8 @@ bool Mapper004::MapCPUWrite(uint16_t addr, uint8_t data) {
 
             prg_banks[1] = (registers[7] & 0x3f) * 0x2000;
             prg_banks[3] = (cart.GetPrgRomBlocks() * 2 - 1) * 0x2000;
+            UpdateCPUPages();
+            UpdatePPUPages();
         }
         return true;
     }
@@ -115,6 +131,7 @@ bool Mapper004::MapCPUWrite(uint16_t addr, uint8_t data) {
                 mirror_mode = Mapper::MirrorMode::HORIZONTAL;
             else
                 mirror_mode = Mapper::MirrorMode::VERTICAL;
+            UpdatePPUPages();
         } else {
             // prg ram protect
             // TODO:
@@ -143,14 +160,18 @@ bool Mapper004::MapCPUWrite(uint16_t addr, uint8_t data) {
 }
 
 uint8_t Mapper004::MapPPURead(uint16_t addr) {
+    return cart.ReadChrRom(MapPPUAddr(addr));
+}
+
+size_t Mapper004::MapPPUAddr(uint16_t addr) {
     // Each one of these blocks points to 1k, so addr / 0x400 is the index
     // and addr % 0x400 is the offset
-    return cart.ReadChrRom(chr_banks[addr / 0x400] + (addr % 0x400));
+    return chr_banks[addr / 0x400] + (addr % 0x400);
 }
 
 bool Mapper004::MapPPUWrite(uint16_t addr, uint8_t data) {
     if (cart.GetChrRomBlocks() == 0) {
-        cart.WriteChrRom(chr_banks[addr / 0x400] + (addr % 0x400), data);
+        cart.WriteChrRom(MapPPUAddr(addr), data);
         return true;
     }
 
@@ -21,13 +21,13 @@
 #include "Mapper.h"
 
 namespace NESCLE {
-class Mapper004 : public Mapper {
+class Mapper004 final : public Mapper {
 private:
     // FIXME: SHOULDN'T THESE BE 8 BYTES
     // FIXME: CONVERT THESE TO std::arrays
-    uint32_t registers[8];
-    uint32_t chr_banks[8];
-    uint32_t prg_banks[4];
+    uint32_t registers[8]{};
+    uint32_t chr_banks[8]{};
+    uint32_t prg_banks[4]{};
 
     uint8_t target_register = 0;
     bool prg_bank_mode = false;
@@ -39,17 +39,20 @@ private:
     uint16_t irq_counter;
     uint16_t irq_reload;
 
-    std::array<uint8_t, 0x8000> sram;
+    std::array<uint8_t, 0x8000> sram{};
 
 public:
     Mapper004(uint8_t id, Cart& cart, Mapper::MirrorMode mirror)
         : Mapper(id, cart, mirror) {}
 
     void Reset() override;
+    void UpdateCPUPages() override;
+    void UpdatePPUPages() override;
 
     uint8_t MapCPURead(uint16_t addr) override;
     bool MapCPUWrite(uint16_t addr, uint8_t data) override;
     uint8_t MapPPURead(uint16_t addr) override;
+    size_t MapPPUAddr(uint16_t addr) override;
     bool MapPPUWrite(uint16_t addr, uint8_t data) override;
 
     void CountdownScanline() override;
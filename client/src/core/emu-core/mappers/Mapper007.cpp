@@ -20,6 +20,12 @@
 namespace NESCLE {
 void Mapper007::Reset() {
     bank_select = 0;
+    UpdateCPUPages();
+    UpdatePPUPages();
+}
+
+void Mapper007::UpdateCPUPages() {
+    MapPrgRom(0x8000, 0x8000, (size_t)(bank_select & 0x07) << 15);
 }
 
 uint8_t Mapper007::MapCPURead(uint16_t addr) {
@@ -31,8 +37,10 @@ uint8_t Mapper007::MapCPURead(uint16_t addr) {
 
 bool Mapper007::MapCPUWrite(uint16_t addr, uint8_t data) {
     bank_select = data;
+    UpdateCPUPages();
     mirror_mode = (data & 0x10) ? Mapper::MirrorMode::ONESCREEN_HI :
         Mapper::MirrorMode::ONESCREEN_LO;
+    UpdatePPUPages();
     return true;
 }
 
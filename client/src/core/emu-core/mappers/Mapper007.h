@@ -19,7 +19,7 @@
 #include "Mapper.h"
 
 namespace NESCLE {
-class Mapper007 : public Mapper {
+class Mapper007 final : public Mapper {
 private:
     uint8_t bank_select;
 
@@ -28,6 +28,7 @@ public:
         : Mapper(id, cart, mirror), bank_select(0) {}
 
     void Reset() override;
+    void UpdateCPUPages() override;
 
     uint8_t MapCPURead(uint16_t addr) override;
     bool MapCPUWrite(uint16_t addr, uint8_t data) override;
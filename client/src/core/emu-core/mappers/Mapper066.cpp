@@ -20,6 +20,17 @@
 namespace NESCLE {
 void Mapper066::Reset() {
     bank_select = 0;
+    UpdateCPUPages();
+    UpdatePPUPages();
+}
+
+void Mapper066::UpdateCPUPages() {
+    MapPrgRom(0x8000, 0x8000, (size_t)((bank_select & 0x30) >> 4) << 15);
+}
+
+void Mapper066::UpdatePPUPages() {
+    MapChr(0x0000, 0x2000, (size_t)(bank_select & 0x03) << 13);
+    MapNametables();
 }
 
 uint8_t Mapper066::MapCPURead(uint16_t addr) {
@@ -30,18 +41,23 @@ uint8_t Mapper066::MapCPURead(uint16_t addr) {
 
 bool Mapper066::MapCPUWrite(uint16_t addr, uint8_t data) {
     bank_select = data;
+    UpdateCPUPages();
+    UpdatePPUPages();
     return true;
 }
 
 uint8_t Mapper066::MapPPURead(uint16_t addr) {
+    return cart.ReadChrRom(MapPPUAddr(addr));
+}
+
+size_t Mapper066::MapPPUAddr(uint16_t addr) {
     uint8_t select = bank_select & 0x03;
-    return cart.ReadChrRom((size_t)((select << 13) | addr));
+    return (size_t)((select << 13) | addr);
 }
 
 bool Mapper066::MapPPUWrite(uint16_t addr, uint8_t data) {
     if (cart.GetChrRomBlocks() == 0) {
-        uint8_t select = bank_select & 0x03;
-        cart.WriteChrRom((size_t)((select << 13) | addr), data);
+        cart.WriteChrRom(MapPPUAddr(addr), data);
         return true;
     }
     return false;
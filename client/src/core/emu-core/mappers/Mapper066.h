@@ -19,7 +19,7 @@
 #include "Mapper.h"
 
 namespace NESCLE {
-class Mapper066 : public Mapper {
+class Mapper066 final : public Mapper {
 private:
     uint8_t bank_select;
 
@@ -28,10 +28,13 @@ public:
         : Mapper(id, cart, mirror), bank_select(0) {}
 
     void Reset() override;
+    void UpdateCPUPages() override;
+    void UpdatePPUPages() override;
 
     uint8_t MapCPURead(uint16_t addr) override;
     bool MapCPUWrite(uint16_t addr, uint8_t data) override;
     uint8_t MapPPURead(uint16_t addr) override;
+    size_t MapPPUAddr(uint16_t addr) override;
     bool MapPPUWrite(uint16_t addr, uint8_t data) override;
 
 protected:
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2023 Edward C. Pinkston
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MAPPERDISPATCH_H_
+#define MAPPERDISPATCH_H_
+
+#include "Mapper.h"
+#include "Mapper000.h"
+#include "Mapper001.h"
+#include "Mapper002.h"
+#include "Mapper003.h"
+#include "Mapper004.h"
+#include "Mapper007.h"
+#include "Mapper066.h"
+
+namespace NESCLE {
+// Calls f with mapper as its concrete class, the same ones
+// Mapper::CreateMapperFromID picks from. Every mapper is final, so the calls
+// f makes are direct (and inlinable) instead of going through the vtable.
+// f must return the same type for every mapper
+template <typename F>
+inline decltype(auto) Mapper_Dispatch(Mapper& mapper, F&& f) {
+    switch (mapper.GetID()) {
+    case 0:
+        return f(static_cast<Mapper000&>(mapper));
+    case 1:
+        return f(static_cast<Mapper001&>(mapper));
+    case 2:
+        return f(static_cast<Mapper002&>(mapper));
+    case 3:
+        return f(static_cast<Mapper003&>(mapper));
+    case 4:
+        return f(static_cast<Mapper004&>(mapper));
+    case 7:
+        return f(static_cast<Mapper007&>(mapper));
+    case 66:
+        return f(static_cast<Mapper066&>(mapper));
+    default:
+        return f(mapper);
+    }
+}
+}
+#endif // MAPPERDISPATCH_H_
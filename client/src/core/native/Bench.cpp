@@ -0,0 +1,291 @@
+/*
+ * Copyright 2023 Edward C. Pinkston
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Microbenchmarks for the hot paths of the core. Each benchmark drives one
+// component directly (CPU::Clock, PPU::Clock, APU::Clock, Bus::Read/Write)
+// on a system that has already been booted into a known state, plus whole
+// frames for every synthetic ROM and any real ROMs passed with --rom.
+//
+// Usage: nescle-bench [--json] [--reps N] [--filter STR] [--rom PATH]... [--list]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "SyntheticROM.h"
+#include "../emu-core/Bus.h"
+
+using namespace NESCLE;
+
+namespace {
+struct Benchmark {
+    std::string name;
+    std::string unit;
+    // Number of ops performed by one call to run
+    uint64_t ops;
+    // Returns false if the workload can't be set up (bad ROM path, etc.)
+    std::function<bool(Bus&)> setup;
+    std::function<void(Bus&, uint64_t)> run;
+};
+
+struct Stats {
+    double mean;
+    double stddev;
+    double min;
+    double max;
+    double median;
+};
+
+// Keeps the compiler from throwing away reads whose value we never use
+volatile uint32_t sink;
+
+void RunFrames(Bus& bus, uint64_t frames) {
+    PPU& ppu = bus.GetPPU();
+    for (uint64_t i = 0; i < frames; i++) {
+        while (!ppu.GetFrameComplete())
+            bus.Run();
+        ppu.ClearFrameComplete();
+    }
+}
+
+// Boots a workload and lets it run long enough to have rendering, sprites
+// and audio switched on
+std::function<bool(Bus&)> Boot(const std::string& spec, uint64_t frames) {
+    return [spec, frames](Bus& bus) {
+        if (!SyntheticROM_LoadWorkload(bus, spec))
+            return false;
+        bus.SetSampleFrequency(48000);
+        RunFrames(bus, frames);
+        return true;
+    };
+}
+
+// A fixed, realistic spread of CPU addresses: mostly RAM and PRG with the
+// odd register access, so every arm of the decode chain is taken
+std::vector<uint16_t> MakeAddressMix(bool for_writes) {
+    std::vector<uint16_t> addrs(4096);
+    uint32_t state = 0x12345678;
+    for (auto& addr : addrs) {
+        state = state * 1664525 + 1013904223;
+        uint32_t r = state >> 8;
+        uint32_t kind = r % 100;
+        if (for_writes) {
+            if (kind < 75)
+                addr = r % 0x2000;
+            else if (kind < 90)
+                addr = 0x4000 + r % 0x14;
+            else
+                addr = 0x2005;
+        } else {
+            if (kind < 50)
+                addr = r % 0x2000;
+            else if (kind < 95)
+                addr = 0x8000 + r % 0x8000;
+            else if (kind < 98)
+                addr = 0x4015;
+            else
+                addr = 0x2002;
+        }
+    }
+    return addrs;
+}
+
+std::vector<Benchmark> MakeBenchmarks(const std::vector<std::string>& roms) {
+    std::vector<Benchmark> benches;
+
+    benches.push_back({ "cpu.clock", "clock", 2000000, Boot("synthetic:cpu", 2),
+        [](Bus& bus, uint64_t n) {
+            CPU& cpu = bus.GetCPU();
+            for (uint64_t i = 0; i < n; i++)
+                cpu.Clock();
+        } });
+
+    benches.push_back({ "ppu.clock", "dot", 2000000, Boot("synthetic:ppu", 30),
+        [](Bus& bus, uint64_t n) {
+            PPU& ppu = bus.GetPPU();
+            for (uint64_t i = 0; i < n; i++)
+                ppu.Clock();
+        } });
+
+    benches.push_back({ "apu.clock", "tick", 2000000, Boot("synthetic:ppu", 30),
+        [](Bus& bus, uint64_t n) {
+            APU& apu = bus.GetAPU();
+            for (uint64_t i = 0; i < n; i++)
+                apu.Clock();
+        } });
+
+    benches.push_back({ "bus.read", "read", 4000000, Boot("synthetic:ppu", 2),
+        [](Bus& bus, uint64_t n) {
+            static const std::vector<uint16_t> addrs = MakeAddressMix(false);
+            uint32_t acc = 0;
+            for (uint64_t i = 0; i < n; i++)
+                acc += bus.Read(addrs[i & (addrs.size() - 1)]);
+            sink = acc;
+        } });
+
+    benches.push_back({ "bus.write", "write", 4000000, Boot("synthetic:ppu", 2),
+        [](Bus& bus, uint64_t n) {
+            static const std::vector<uint16_t> addrs = MakeAddressMix(true);
+            for (uint64_t i = 0; i < n; i++)
+                bus.Write(addrs[i & (addrs.size() - 1)], static_cast<uint8_t>(i));
+        } });
+
+    std::vector<std::string> workloads;
+    for (const auto& name : SyntheticROM_Names())
+        workloads.push_back("synthetic:" + name);
+    workloads.insert(workloads.end(), roms.begin(), roms.end());
+
+    for (const auto& spec : workloads) {
+        std::string label = spec;
+        size_t slash = label.find_last_of("/\\");
+        if (slash != std::string::npos)
+            label = label.substr(slash + 1);
+        benches.push_back({ "frame/" + label, "frame", 30, Boot(spec, 10), RunFrames });
+    }
+
+    return benches;
+}
+
+Stats ComputeStats(std::vector<double> samples) {
+    Stats stats{};
+    double sum = 0.0;
+    for (double s : samples)
+        sum += s;
+    stats.mean = sum / samples.size();
+
+    double var = 0.0;
+    for (double s : samples)
+        var += (s - stats.mean) * (s - stats.mean);
+    stats.stddev = samples.size() > 1 ? std::sqrt(var / (samples.size() - 1)) : 0.0;
+
+    std::sort(samples.begin(), samples.end());
+    stats.min = samples.front();
+    stats.max = samples.back();
+    size_t mid = samples.size() / 2;
+    stats.median = samples.size() % 2 ? samples[mid]
+        : (samples[mid - 1] + samples[mid]) / 2.0;
+    return stats;
+}
+
+void PrintUsage(const char* prog) {
+    fprintf(stderr, "usage: %s [--json] [--reps N] [--filter STR] [--rom PATH]... [--list]\n", prog);
+}
+}
+
+int main(int argc, char** argv) {
+    bool json_output = false;
+    bool list_only = false;
+    int reps = 10;
+    std::string filter;
+    std::vector<std::string> roms;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--json") {
+            json_output = true;
+        } else if (arg == "--list") {
+            list_only = true;
+        } else if (arg == "--reps" && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--rom" && i + 1 < argc) {
+            roms.push_back(argv[++i]);
+        } else {
+            PrintUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (reps < 1) {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    auto benches = MakeBenchmarks(roms);
+    if (list_only) {
+        for (const auto& bench : benches)
+            printf("%s\n", bench.name.c_str());
+        return EXIT_SUCCESS;
+    }
+
+    nlohmann::json results = nlohmann::json::array();
+    if (!json_output)
+        printf("%-24s %8s %12s %10s %12s %12s\n", "benchmark", "unit",
+            "mean ns/op", "stddev", "min", "max");
+
+    // FIXME: ONE BUS FOR THE WHOLE RUN, THE CPU'S STATIC DISPATCH TABLES
+    //        STAY BOUND TO THE FIRST CPU THAT EVER CLOCKS
+    auto bus = std::make_unique<Bus>();
+    bool failed = false;
+    for (const auto& bench : benches) {
+        if (!filter.empty() && bench.name.find(filter) == std::string::npos)
+            continue;
+
+        if (!bench.setup(*bus)) {
+            fprintf(stderr, "%s: setup failed\n", bench.name.c_str());
+            failed = true;
+            continue;
+        }
+
+        // One untimed pass to warm caches and the branch predictors
+        bench.run(*bus, bench.ops);
+
+        std::vector<double> samples;
+        for (int rep = 0; rep < reps; rep++) {
+            auto start = std::chrono::steady_clock::now();
+            bench.run(*bus, bench.ops);
+            auto end = std::chrono::steady_clock::now();
+            double ns = std::chrono::duration<double, std::nano>(end - start).count();
+            samples.push_back(ns / bench.ops);
+        }
+
+        Stats stats = ComputeStats(samples);
+        if (json_output) {
+            results.push_back({
+                { "name", bench.name },
+                { "unit", bench.unit },
+                { "ops_per_rep", bench.ops },
+                { "reps", reps },
+                { "ns_per_op", {
+                    { "mean", stats.mean },
+                    { "stddev", stats.stddev },
+                    { "min", stats.min },
+                    { "max", stats.max },
+                    { "median", stats.median }
+                } },
+                { "samples", samples }
+            });
+        } else {
+            printf("%-24s %8s %12.2f %9.1f%% %12.2f %12.2f\n", bench.name.c_str(),
+                bench.unit.c_str(), stats.mean, 100.0 * stats.stddev / stats.mean,
+                stats.min, stats.max);
+        }
+    }
+
+    if (json_output)
+        printf("%s\n", nlohmann::json{ { "benchmarks", results } }.dump(2).c_str());
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,380 @@
+/*
+ * Copyright 2023 Edward C. Pinkston
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Golden frame/audio hash recorder and checker. Boots a ROM from a fixed
+// power-on state, plays back scripted controller input and hashes the
+// framebuffer and the mixed audio of every frame. "record" writes those
+// hashes to a golden file, "verify" reruns the ROM and reports the first
+// frames that no longer match.
+//
+// Usage:
+//   nescle-golden record <rom.nes|synthetic:NAME> <golden.txt> [options]
+//   nescle-golden verify <rom.nes|synthetic:NAME> <golden.txt> [options]
+// Options:
+//   --frames N      frames to run (record only, default 600)
+//   --input FILE    controller script, one "<frame> <buttons...>" per line
+//                   where buttons are a b select start up down left right,
+//                   none, or a hex mask like 0x81
+//   --ram-seed N    fill RAM from a seeded generator instead of zeros
+//   --no-run-ahead  step the CPU, PPU and APU together every tick, to check
+//                   that letting the CPU run ahead changes nothing
+//   --no-predecode  decode every instruction as it is fetched, to check the
+//                   predecoded PRG ROM code against the plain interpreter
+//   --switch-predecode N
+//                   flip between the two every N frames, to check that
+//                   switching at runtime changes nothing
+//   --no-idle-skip  run every trip around idle loops, to check that
+//                   skipping them changes nothing
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "SyntheticROM.h"
+#include "../emu-core/Bus.h"
+
+using namespace NESCLE;
+
+namespace {
+constexpr int DEFAULT_FRAMES = 600;
+constexpr uint32_t SAMPLE_RATE = 48000;
+constexpr int MAX_REPORTED_MISMATCHES = 10;
+
+struct FrameHash {
+    uint64_t video;
+    uint64_t audio;
+    uint32_t nsamples;
+};
+
+struct Options {
+    std::string rom;
+    std::string golden;
+    std::string input;
+    int frames = DEFAULT_FRAMES;
+    bool has_seed = false;
+    uint32_t seed = 0;
+    bool run_ahead = true;
+    bool predecode = true;
+    int switch_predecode = 0;
+    bool idle_skip = true;
+};
+
+// 64-bit FNV-1a. Values are fed in little endian byte order so the hashes
+// don't depend on the host.
+class Hasher {
+private:
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+public:
+    void Byte(uint8_t b) {
+        hash ^= b;
+        hash *= 0x100000001b3ULL;
+    }
+    void U32(uint32_t v) {
+        for (int i = 0; i < 4; i++)
+            Byte((v >> (8 * i)) & 0xff);
+    }
+    void Float(float f) {
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        U32(bits);
+    }
+    uint64_t Get() const { return hash; }
+};
+
+uint64_t HashString(const std::string& str) {
+    Hasher hasher;
+    for (char c : str)
+        hasher.Byte(static_cast<uint8_t>(c));
+    return hasher.Get();
+}
+
+// Frame -> controller state, each entry holds until the next one
+bool ParseInputScript(const std::string& path, std::map<int, uint8_t>& script,
+    std::string& contents) {
+    static const std::map<std::string, uint8_t> buttons = {
+        { "a", (uint8_t)Bus::NESButtons::A },
+        { "b", (uint8_t)Bus::NESButtons::B },
+        { "select", (uint8_t)Bus::NESButtons::SELECT },
+        { "start", (uint8_t)Bus::NESButtons::START },
+        { "up", (uint8_t)Bus::NESButtons::UP },
+        { "down", (uint8_t)Bus::NESButtons::DOWN },
+        { "left", (uint8_t)Bus::NESButtons::LEFT },
+        { "right", (uint8_t)Bus::NESButtons::RIGHT },
+        { "none", 0 }
+    };
+
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        fprintf(stderr, "unable to open input script %s\n", path.c_str());
+        return false;
+    }
+
+    std::string line;
+    int line_no = 0;
+    while (std::getline(file, line)) {
+        line_no++;
+        contents += line + "\n";
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream ss(line);
+        int frame;
+        if (!(ss >> frame))
+            continue;
+
+        uint8_t state = 0;
+        std::string tok;
+        while (ss >> tok) {
+            auto it = buttons.find(tok);
+            if (it != buttons.end()) {
+                state |= it->second;
+            } else if (tok.rfind("0x", 0) == 0) {
+                state |= static_cast<uint8_t>(strtoul(tok.c_str(), nullptr, 16));
+            } else {
+                fprintf(stderr, "%s:%d: unknown button %s\n", path.c_str(),
+                    line_no, tok.c_str());
+                return false;
+            }
+        }
+        script[frame] = state;
+    }
+    return true;
+}
+
+bool RunROM(const Options& opts, const std::map<int, uint8_t>& script,
+    std::vector<FrameHash>& hashes) {
+    auto bus = std::make_unique<Bus>();
+    if (!SyntheticROM_LoadWorkload(*bus, opts.rom)) {
+        fprintf(stderr, "failed to load %s\n", opts.rom.c_str());
+        return false;
+    }
+    if (opts.has_seed)
+        bus->ClearMemRand(opts.seed);
+    bus->SetSampleFrequency(SAMPLE_RATE);
+    bus->SetCPURunAhead(opts.run_ahead);
+    bus->GetCPU().SetPredecode(opts.predecode);
+    bus->SetCPUIdleSkip(opts.idle_skip);
+
+    PPU& ppu = bus->GetPPU();
+    std::vector<float> samples(SAMPLE_RATE / 10);
+    bool predecode = opts.predecode;
+    for (int frame = 0; frame < opts.frames; frame++) {
+        auto input = script.find(frame);
+        if (input != script.end())
+            bus->SetController1(input->second);
+        if (opts.switch_predecode > 0 && frame > 0
+            && frame % opts.switch_predecode == 0) {
+            predecode = !predecode;
+            bus->GetCPU().SetPredecode(predecode);
+        }
+
+        Hasher audio;
+        uint32_t nsamples = 0;
+        while (!ppu.GetFrameComplete()) {
+            size_t n = bus->RunFrame(samples.data(), samples.size());
+            for (size_t i = 0; i < n; i++)
+                audio.Float(samples[i]);
+            nsamples += (uint32_t)n;
+        }
+        ppu.ClearFrameComplete();
+
+        Hasher video;
+        const uint32_t* fb = ppu.GetFramebuffer();
+        for (int i = 0; i < PPU::RESOLUTION_X * PPU::RESOLUTION_Y; i++)
+            video.U32(fb[i]);
+
+        hashes.push_back({ video.Get(), audio.Get(), nsamples });
+    }
+    return true;
+}
+
+bool WriteGolden(const Options& opts, uint64_t input_hash,
+    const std::vector<FrameHash>& hashes) {
+    FILE* file = fopen(opts.golden.c_str(), "w");
+    if (file == nullptr) {
+        fprintf(stderr, "unable to write %s\n", opts.golden.c_str());
+        return false;
+    }
+
+    fprintf(file, "# nescle golden v1\n");
+    fprintf(file, "# rom %s\n", opts.rom.c_str());
+    fprintf(file, "frames %d\n", opts.frames);
+    fprintf(file, "sample_rate %" PRIu32 "\n", SAMPLE_RATE);
+    if (opts.has_seed)
+        fprintf(file, "ram_seed %" PRIu32 "\n", opts.seed);
+    fprintf(file, "input %016" PRIx64 "\n", input_hash);
+    fprintf(file, "# frame video audio samples\n");
+    for (size_t i = 0; i < hashes.size(); i++) {
+        fprintf(file, "%zu %016" PRIx64 " %016" PRIx64 " %" PRIu32 "\n", i,
+            hashes[i].video, hashes[i].audio, hashes[i].nsamples);
+    }
+    fclose(file);
+    return true;
+}
+
+bool ReadGolden(Options& opts, uint64_t& input_hash, std::vector<FrameHash>& hashes) {
+    std::ifstream file(opts.golden);
+    if (!file.is_open()) {
+        fprintf(stderr, "unable to open %s\n", opts.golden.c_str());
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream ss(line);
+        std::string key;
+        ss >> key;
+        if (key == "frames") {
+            ss >> opts.frames;
+        } else if (key == "sample_rate") {
+            uint32_t rate;
+            ss >> rate;
+            if (rate != SAMPLE_RATE) {
+                fprintf(stderr, "%s was recorded at %u Hz\n", opts.golden.c_str(), rate);
+                return false;
+            }
+        } else if (key == "ram_seed") {
+            ss >> opts.seed;
+            opts.has_seed = true;
+        } else if (key == "input") {
+            ss >> std::hex >> input_hash;
+        } else {
+            FrameHash hash;
+            ss >> std::hex >> hash.video >> hash.audio >> std::dec >> hash.nsamples;
+            if (ss.fail()) {
+                fprintf(stderr, "%s: malformed line: %s\n", opts.golden.c_str(), line.c_str());
+                return false;
+            }
+            hashes.push_back(hash);
+        }
+    }
+    return true;
+}
+
+void PrintUsage(const char* prog) {
+    fprintf(stderr, "usage: %s record|verify <rom.nes|synthetic:NAME> <golden.txt>"
+        " [--frames N] [--input FILE] [--ram-seed N] [--no-run-ahead]"
+        " [--no-predecode] [--switch-predecode N] [--no-idle-skip]\n", prog);
+}
+}
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::string mode = argv[1];
+    Options opts;
+    opts.rom = argv[2];
+    opts.golden = argv[3];
+    for (int i = 4; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) {
+            opts.frames = atoi(argv[++i]);
+        } else if (arg == "--input" && i + 1 < argc) {
+            opts.input = argv[++i];
+        } else if (arg == "--ram-seed" && i + 1 < argc) {
+            opts.seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 0));
+            opts.has_seed = true;
+        } else if (arg == "--no-run-ahead") {
+            opts.run_ahead = false;
+        } else if (arg == "--no-predecode") {
+            opts.predecode = false;
+        } else if (arg == "--switch-predecode" && i + 1 < argc) {
+            opts.switch_predecode = atoi(argv[++i]);
+        } else if (arg == "--no-idle-skip") {
+            opts.idle_skip = false;
+        } else {
+            PrintUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if ((mode != "record" && mode != "verify") || opts.frames <= 0) {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::map<int, uint8_t> script;
+    std::string script_contents;
+    if (!opts.input.empty() && !ParseInputScript(opts.input, script, script_contents))
+        return EXIT_FAILURE;
+    uint64_t input_hash = HashString(script_contents);
+
+    if (mode == "record") {
+        std::vector<FrameHash> hashes;
+        if (!RunROM(opts, script, hashes) || !WriteGolden(opts, input_hash, hashes))
+            return EXIT_FAILURE;
+        printf("recorded %d frames of %s to %s\n", opts.frames, opts.rom.c_str(),
+            opts.golden.c_str());
+        return EXIT_SUCCESS;
+    }
+
+    uint64_t golden_input_hash = 0;
+    std::vector<FrameHash> expected;
+    if (!ReadGolden(opts, golden_input_hash, expected))
+        return EXIT_FAILURE;
+    if (golden_input_hash != input_hash) {
+        fprintf(stderr, "input script differs from the one %s was recorded with\n",
+            opts.golden.c_str());
+        return EXIT_FAILURE;
+    }
+    if (static_cast<int>(expected.size()) != opts.frames) {
+        fprintf(stderr, "%s is truncated\n", opts.golden.c_str());
+        return EXIT_FAILURE;
+    }
+
+    std::vector<FrameHash> actual;
+    if (!RunROM(opts, script, actual))
+        return EXIT_FAILURE;
+
+    int mismatches = 0;
+    for (int i = 0; i < opts.frames; i++) {
+        const FrameHash& want = expected[i];
+        const FrameHash& got = actual[i];
+        bool video_ok = want.video == got.video;
+        bool audio_ok = want.audio == got.audio && want.nsamples == got.nsamples;
+        if (video_ok && audio_ok)
+            continue;
+
+        if (mismatches < MAX_REPORTED_MISMATCHES) {
+            printf("frame %d:%s%s\n", i, video_ok ? "" : " video differs",
+                audio_ok ? "" : " audio differs");
+        }
+        mismatches++;
+    }
+
+    if (mismatches > 0) {
+        printf("FAIL: %d of %d frames of %s differ from %s\n", mismatches,
+            opts.frames, opts.rom.c_str(), opts.golden.c_str());
+        return EXIT_FAILURE;
+    }
+    printf("OK: %d frames of %s match %s\n", opts.frames, opts.rom.c_str(),
+        opts.golden.c_str());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2023 Edward C. Pinkston
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs a ROM with no audio or video output as fast as the host allows and
+// reports how quickly the core got through it. With --audio, the samples go
+// through an AudioRing to a second thread that plays them at 48kHz like a
+// sound card would, and the emulator only runs when the ring has room for a
+// frame, so the ring's underrun and overrun counts can be checked.
+//
+// Usage: nescle-headless <rom.nes> [frames] [--audio]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../emu-core/AudioRing.h"
+#include "../emu-core/Bus.h"
+
+using namespace NESCLE;
+
+namespace {
+constexpr int DEFAULT_FRAMES = 600;
+// The NES CPU runs at a third of the master clock
+constexpr double CPU_FREQ = 5369318.0 / 3.0;
+constexpr double NES_FPS = 60.0988;
+
+constexpr uint32_t SAMPLE_RATE = 48000;
+// What an AudioWorklet gets to fill on each call
+constexpr size_t AUDIO_QUANTUM = 128;
+// Frames' worth of audio queued up before the consumer starts
+constexpr int AUDIO_PRIME_FRAMES = 2;
+
+void PrintUsage(const char* prog) {
+    fprintf(stderr, "usage: %s <rom.nes> [frames] [--audio]\n", prog);
+}
+
+// Takes a quantum out of the ring every time the sound card would, until
+// told to stop
+void PlayAudio(AudioRing& ring, const std::atomic<bool>& stop) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<float> quantum(AUDIO_QUANTUM);
+    auto period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>((double)AUDIO_QUANTUM / SAMPLE_RATE));
+    auto next = Clock::now();
+    while (!stop.load(std::memory_order_relaxed)) {
+        ring.Read(quantum.data(), quantum.size());
+        next += period;
+        std::this_thread::sleep_until(next);
+    }
+}
+}
+
+int main(int argc, char** argv) {
+    bool audio = argc > 2 && strcmp(argv[argc - 1], "--audio") == 0;
+    if (audio)
+        argc--;
+    if (argc < 2 || argc > 3) {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char* rom_path = argv[1];
+    int frames = DEFAULT_FRAMES;
+    if (argc == 3) {
+        frames = atoi(argv[2]);
+        if (frames <= 0) {
+            PrintUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // The bus holds the screen buffers, so it is too big for the stack
+    auto nes = std::make_unique<Bus>();
+    nes->PowerOn();
+    nes->SetSampleFrequency(SAMPLE_RATE);
+
+    if (!nes->GetCart().LoadROM(rom_path)) {
+        fprintf(stderr, "failed to load %s\n", rom_path);
+        return EXIT_FAILURE;
+    }
+    if (nes->GetCart().GetMapper() == nullptr) {
+        fprintf(stderr, "%s uses an unsupported mapper\n", rom_path);
+        return EXIT_FAILURE;
+    }
+    nes->Reset();
+
+    using Clock = std::chrono::steady_clock;
+    PPU& ppu = nes->GetPPU();
+    double min_ms = 1e300;
+    double max_ms = 0.0;
+    uint64_t start_clocks = nes->GetClocksCount();
+
+    // Only the time spent emulating counts, not the time waiting on audio
+    auto ring = std::make_unique<AudioRing>();
+    std::vector<float> samples(SAMPLE_RATE / 30);
+    std::atomic<bool> stop_audio(false);
+    std::thread audio_thread;
+    double secs = 0.0;
+
+    for (int i = 0; i < frames; i++) {
+        if (audio && i == AUDIO_PRIME_FRAMES)
+            audio_thread = std::thread(PlayAudio, std::ref(*ring), std::cref(stop_audio));
+        while (audio && ring->GetFree() < samples.size())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        auto frame_start = Clock::now();
+        size_t nsamples = nes->RunFrame(samples.data(), samples.size());
+        ppu.ClearFrameComplete();
+        auto frame_end = Clock::now();
+        if (audio)
+            ring->Write(samples.data(), nsamples);
+
+        double ms = std::chrono::duration<double, std::milli>(frame_end - frame_start).count();
+        secs += ms / 1000.0;
+        if (ms < min_ms)
+            min_ms = ms;
+        if (ms > max_ms)
+            max_ms = ms;
+    }
+
+    if (audio_thread.joinable()) {
+        // Let it play out what is left
+        while (ring->GetAvail() >= AUDIO_QUANTUM)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        stop_audio.store(true, std::memory_order_relaxed);
+        audio_thread.join();
+    }
+
+    double cpu_cycles = (nes->GetClocksCount() - start_clocks) / 3.0;
+    double fps = frames / secs;
+
+    printf("rom:              %s\n", rom_path);
+    printf("frames:           %d\n", frames);
+    printf("run time:         %.3f s\n", secs);
+    printf("frames/sec:       %.1f (%.2fx realtime)\n", fps, fps / NES_FPS);
+    printf("cpu cycles/sec:   %.0f (%.2fx realtime)\n", cpu_cycles / secs,
+        cpu_cycles / secs / CPU_FREQ);
+    printf("ms/frame:         avg %.3f, min %.3f, max %.3f\n",
+        secs * 1000.0 / frames, min_ms, max_ms);
+    if (audio) {
+        printf("audio underruns:  %u samples\n", ring->GetUnderruns());
+        printf("audio overruns:   %u samples\n", ring->GetOverruns());
+    }
+
+    return EXIT_SUCCESS;
+}
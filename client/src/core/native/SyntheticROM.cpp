@@ -0,0 +1,844 @@
+/*
+ * Copyright 2023 Edward C. Pinkston
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "SyntheticROM.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+#include "../emu-core/Bus.h"
+#include "../Util.h"
+
+namespace NESCLE {
+namespace {
+// Only the opcodes the programs below actually use
+enum Op : uint8_t {
+    ADC_IMM = 0x69, ADC_ZPG = 0x65, ADC_ABX = 0x7d,
+    AND_IMM = 0x29,
+    ASL_ACC = 0x0a, ASL_ZPG = 0x06,
+    BCC = 0x90, BCS = 0xb0, BEQ = 0xf0, BMI = 0x30, BNE = 0xd0, BPL = 0x10,
+    BVC = 0x50, BVS = 0x70,
+    BIT_ABS = 0x2c,
+    CLC = 0x18, CLD = 0xd8, CLI = 0x58, SEC = 0x38, SEI = 0x78,
+    CMP_IMM = 0xc9, CPX_IMM = 0xe0,
+    DEX = 0xca, DEY = 0x88, INX = 0xe8, INY = 0xc8,
+    INC_ZPG = 0xe6,
+    EOR_IMM = 0x49, EOR_ZPG = 0x45, EOR_IDY = 0x51,
+    JMP_ABS = 0x4c, JMP_IND = 0x6c, JSR = 0x20, RTS = 0x60, RTI = 0x40,
+    LDA_IMM = 0xa9, LDA_ZPG = 0xa5, LDA_ABS = 0xad, LDA_ABX = 0xbd,
+    LDA_ABY = 0xb9, LDA_IDY = 0xb1,
+    LDX_IMM = 0xa2, LDY_IMM = 0xa0,
+    LSR_ACC = 0x4a, LSR_ZPG = 0x46,
+    ORA_IMM = 0x09,
+    PHA = 0x48, PHP = 0x08, PLA = 0x68, PLP = 0x28,
+    ROL_ACC = 0x2a, ROL_ZPG = 0x26, ROR_ZPG = 0x66,
+    SBC_IMM = 0xe9,
+    STA_ZPG = 0x85, STA_ZPX = 0x95, STA_ABS = 0x8d, STA_ABX = 0x9d,
+    STA_ABY = 0x99, STA_IDY = 0x91,
+    STY_ZPG = 0x84,
+    TAX = 0xaa, TAY = 0xa8, TXA = 0x8a, TYA = 0x98, TXS = 0x9a
+};
+
+// Zero page layout shared by all of the programs
+constexpr uint8_t ZP_TMP = 0x00;
+constexpr uint8_t ZP_FRAME = 0x10;
+constexpr uint8_t ZP_SPLIT = 0x11;
+constexpr uint8_t ZP_LOOPS = 0x12;
+constexpr uint8_t ZP_BANK = 0x14;
+constexpr uint8_t ZP_SUM = 0x15;
+constexpr uint8_t ZP_IRQS = 0x16;
+constexpr uint8_t ZP_NMI_FLAG = 0x17;
+constexpr uint8_t ZP_PAD = 0x19;
+constexpr uint8_t ZP_PTR = 0x20;
+constexpr uint8_t ZP_SCRATCH = 0x30;
+constexpr uint16_t OAM_BUF = 0x0200;
+
+// Bare bones single pass 6502 assembler with label fixups
+class Assembler {
+private:
+    struct Fixup {
+        size_t pos;
+        std::string label;
+        bool relative;
+    };
+
+    uint16_t origin;
+    std::vector<uint8_t> code;
+    std::map<std::string, uint16_t> labels;
+    std::vector<Fixup> fixups;
+
+public:
+    explicit Assembler(uint16_t _origin) : origin(_origin) {}
+
+    uint16_t PC() const { return origin + static_cast<uint16_t>(code.size()); }
+
+    void Label(const std::string& name) { labels[name] = PC(); }
+    void Byte(uint8_t b) { code.push_back(b); }
+    void Bytes(const std::vector<uint8_t>& bytes) {
+        code.insert(code.end(), bytes.begin(), bytes.end());
+    }
+    void Word(uint16_t w) { Byte(w & 0xff); Byte(w >> 8); }
+
+    void Op(uint8_t opcode) { Byte(opcode); }
+    void Op(uint8_t opcode, uint8_t operand) { Byte(opcode); Byte(operand); }
+    void OpW(uint8_t opcode, uint16_t operand) { Byte(opcode); Word(operand); }
+
+    // Absolute operand (or data word) referring to a label
+    void OpL(uint8_t opcode, const std::string& label) {
+        Byte(opcode);
+        WordL(label);
+    }
+    void WordL(const std::string& label) {
+        fixups.push_back({ code.size(), label, false });
+        Word(0);
+    }
+    void Branch(uint8_t opcode, const std::string& label) {
+        Byte(opcode);
+        fixups.push_back({ code.size(), label, true });
+        Byte(0);
+    }
+
+    // Resolves all label references and pads the output to size bytes
+    std::vector<uint8_t> Link(size_t size, uint8_t fill = 0xea) {
+        for (const auto& fixup : fixups) {
+            auto it = labels.find(fixup.label);
+            if (it == labels.end()) {
+                fprintf(stderr, "SyntheticROM: undefined label %s\n", fixup.label.c_str());
+                abort();
+            }
+            if (fixup.relative) {
+                int offset = it->second - (origin + static_cast<int>(fixup.pos) + 1);
+                if (offset < -128 || offset > 127) {
+                    fprintf(stderr, "SyntheticROM: branch to %s out of range\n", fixup.label.c_str());
+                    abort();
+                }
+                code[fixup.pos] = static_cast<uint8_t>(offset);
+            } else {
+                code[fixup.pos] = it->second & 0xff;
+                code[fixup.pos + 1] = it->second >> 8;
+            }
+        }
+        if (code.size() > size) {
+            fprintf(stderr, "SyntheticROM: program does not fit in its bank\n");
+            abort();
+        }
+        std::vector<uint8_t> out = code;
+        out.resize(size, fill);
+        return out;
+    }
+
+    // Places the interrupt vectors at the end of a bank that is mapped at
+    // 0xe000-0xffff (or 0xc000-0xffff, the offset works out the same)
+    static void SetVectors(std::vector<uint8_t>& bank, uint16_t nmi,
+        uint16_t reset, uint16_t irq) {
+        size_t end = bank.size();
+        bank[end - 6] = nmi & 0xff;
+        bank[end - 5] = nmi >> 8;
+        bank[end - 4] = reset & 0xff;
+        bank[end - 3] = reset >> 8;
+        bank[end - 2] = irq & 0xff;
+        bank[end - 1] = irq >> 8;
+    }
+
+    uint16_t Addr(const std::string& label) const { return labels.at(label); }
+};
+
+const std::vector<uint8_t> PALETTE = {
+    0x0f, 0x01, 0x11, 0x21, 0x0f, 0x06, 0x16, 0x26,
+    0x0f, 0x09, 0x19, 0x29, 0x0f, 0x02, 0x12, 0x22,
+    0x0f, 0x14, 0x24, 0x34, 0x0f, 0x07, 0x17, 0x27,
+    0x0f, 0x0a, 0x1a, 0x2a, 0x0f, 0x03, 0x13, 0x23
+};
+
+std::vector<uint8_t> MakeOAMTable() {
+    std::vector<uint8_t> oam(256);
+    for (int i = 0; i < 64; i++) {
+        uint8_t y = (i * 29 + 16) % 200;
+        // Pile the last 16 sprites onto the same lines to overflow
+        if (i >= 48)
+            y = 150;
+        oam[i * 4 + 0] = y;
+        oam[i * 4 + 1] = static_cast<uint8_t>(i * 3 + 1);
+        oam[i * 4 + 2] = (i & 3) | ((i & 4) ? 0x40 : 0) | ((i & 8) ? 0x80 : 0)
+            | ((i & 16) ? 0x20 : 0);
+        oam[i * 4 + 3] = (i * 37 + 8) % 240;
+    }
+    // Sprite 0 sits in front of opaque background so it always hits
+    oam[0] = 100;
+    oam[1] = 1;
+    oam[2] = 0;
+    oam[3] = 100;
+    return oam;
+}
+
+// Every tile row is fully opaque (lo | hi == 0xff) but still uses all four
+// colors, so sprite 0 hits are guaranteed and every pixel path gets used
+std::vector<uint8_t> MakeCHR(size_t nbytes) {
+    std::vector<uint8_t> chr(nbytes);
+    for (size_t i = 0; i < nbytes; i++) {
+        size_t tile = i / 16;
+        size_t row = i % 8;
+        uint8_t lo = static_cast<uint8_t>(tile * 37 + row * 11 + 0x5a);
+        if ((i / 8) % 2 == 0)
+            chr[i] = lo;
+        else
+            chr[i] = static_cast<uint8_t>(~lo | (tile + row * 3));
+    }
+    return chr;
+}
+
+std::vector<uint8_t> MakeDataBank(size_t nbytes, int bank) {
+    std::vector<uint8_t> data(nbytes);
+    for (size_t i = 0; i < nbytes; i++)
+        data[i] = static_cast<uint8_t>(bank * 0x11 + i * 7);
+    return data;
+}
+
+std::vector<uint8_t> MakeINES(uint8_t mapper_id, bool vertical,
+    const std::vector<uint8_t>& prg, const std::vector<uint8_t>& chr) {
+    std::vector<uint8_t> rom = {
+        'N', 'E', 'S', 0x1a,
+        static_cast<uint8_t>(prg.size() / Cart::PRG_ROM_CHUNK_SIZE),
+        static_cast<uint8_t>(chr.size() / Cart::CHR_ROM_CHUNK_SIZE),
+        static_cast<uint8_t>(((mapper_id & 0x0f) << 4) | (vertical ? 1 : 0)),
+        static_cast<uint8_t>(mapper_id & 0xf0),
+        0, 0, 0, 0, 0, 0, 0, 0
+    };
+    rom.insert(rom.end(), prg.begin(), prg.end());
+    rom.insert(rom.end(), chr.begin(), chr.end());
+    return rom;
+}
+
+/* Shared program fragments */
+void EmitPrologue(Assembler& a) {
+    a.Label("reset");
+    a.Op(SEI);
+    a.Op(CLD);
+    a.Op(LDX_IMM, 0xff);
+    a.Op(TXS);
+    a.Op(LDA_IMM, 0x00);
+    a.OpW(STA_ABS, 0x2000);
+    a.OpW(STA_ABS, 0x2001);
+    a.OpW(STA_ABS, 0x4010);
+    a.Op(LDA_IMM, 0x40);
+    a.OpW(STA_ABS, 0x4017);
+
+    a.Label("vblank_wait1");
+    a.OpW(BIT_ABS, 0x2002);
+    a.Branch(BPL, "vblank_wait1");
+
+    a.Op(LDA_IMM, 0x00);
+    a.Op(TAX);
+    a.Label("clear_ram");
+    a.Op(STA_ZPX, 0x00);
+    a.OpW(STA_ABX, 0x0300);
+    a.Op(INX);
+    a.Branch(BNE, "clear_ram");
+
+    a.Label("vblank_wait2");
+    a.OpW(BIT_ABS, 0x2002);
+    a.Branch(BPL, "vblank_wait2");
+}
+
+void EmitPPUSetup(Assembler& a) {
+    // Palette
+    a.OpW(LDA_ABS, 0x2002);
+    a.Op(LDA_IMM, 0x3f);
+    a.OpW(STA_ABS, 0x2006);
+    a.Op(LDA_IMM, 0x00);
+    a.OpW(STA_ABS, 0x2006);
+    a.Op(LDX_IMM, 0x00);
+    a.Label("load_palette");
+    a.OpL(LDA_ABX, "palette");
+    a.OpW(STA_ABS, 0x2007);
+    a.Op(INX);
+    a.Op(CPX_IMM, 32);
+    a.Branch(BNE, "load_palette");
+
+    // Both physical nametables, attribute tables included
+    a.Op(LDA_IMM, 0x20);
+    a.OpW(STA_ABS, 0x2006);
+    a.Op(LDA_IMM, 0x00);
+    a.OpW(STA_ABS, 0x2006);
+    a.Op(LDY_IMM, 8);
+    a.Label("fill_nt_page");
+    a.Op(STY_ZPG, ZP_TMP);
+    a.Op(LDX_IMM, 0x00);
+    a.Label("fill_nt");
+    a.Op(TXA);
+    a.Op(EOR_ZPG, ZP_TMP);
+    a.OpW(STA_ABS, 0x2007);
+    a.Op(INX);
+    a.Branch(BNE, "fill_nt");
+    a.Op(DEY);
+    a.Branch(BNE, "fill_nt_page");
+
+    // Shadow OAM
+    a.Op(LDX_IMM, 0x00);
+    a.Label("copy_oam");
+    a.OpL(LDA_ABX, "oam_init");
+    a.OpW(STA_ABX, OAM_BUF);
+    a.Op(INX);
+    a.Branch(BNE, "copy_oam");
+}
+
+void EmitAudioSetup(Assembler& a) {
+    const std::vector<std::pair<uint16_t, uint8_t>> regs = {
+        // Pulse 1 and 2
+        { 0x4000, 0xbf }, { 0x4001, 0x00 }, { 0x4002, 0xfd }, { 0x4003, 0x00 },
+        { 0x4004, 0x7a }, { 0x4005, 0x00 }, { 0x4006, 0xa9 }, { 0x4007, 0x01 },
+        // Triangle
+        { 0x4008, 0xff }, { 0x400a, 0x80 }, { 0x400b, 0x00 },
+        // Noise
+        { 0x400c, 0x3f }, { 0x400e, 0x05 }, { 0x400f, 0x00 },
+        // DMC, looping over 257 bytes at 0xc000
+        { 0x4010, 0x4f }, { 0x4011, 0x40 }, { 0x4012, 0x00 }, { 0x4013, 0x10 },
+        { 0x4015, 0x1f }
+    };
+    for (const auto& reg : regs) {
+        a.Op(LDA_IMM, reg.second);
+        a.OpW(STA_ABS, reg.first);
+    }
+}
+
+void EmitEnableRendering(Assembler& a, uint8_t ctrl) {
+    a.Op(LDA_IMM, 0x00);
+    a.OpW(STA_ABS, 0x2005);
+    a.OpW(STA_ABS, 0x2005);
+    a.Op(LDA_IMM, ctrl);
+    a.OpW(STA_ABS, 0x2000);
+    a.Op(LDA_IMM, 0x1e);
+    a.OpW(STA_ABS, 0x2001);
+}
+
+// Saves registers, kicks off OAM DMA and pokes the nametable. VRAM work
+// specific to one ROM goes between this and EmitNMIFinish.
+void EmitNMIStart(Assembler& a) {
+    a.Label("nmi");
+    a.Op(PHA);
+    a.Op(TXA);
+    a.Op(PHA);
+    a.Op(TYA);
+    a.Op(PHA);
+
+    a.Op(LDA_IMM, 0x00);
+    a.OpW(STA_ABS, 0x2003);
+    a.Op(LDA_IMM, OAM_BUF >> 8);
+    a.OpW(STA_ABS, 0x4014);
+
+    a.Op(LDA_IMM, 0x20);
+    a.OpW(STA_ABS, 0x2006);
+    a.Op(LDA_ZPG, ZP_FRAME);
+    a.OpW(STA_ABS, 0x2006);
+    a.OpW(STA_ABS, 0x2007);
+}
+
+// Moves sprites, reads the pad, sweeps the pulse channels and sets the
+// scroll for the next frame
+void EmitNMIFinish(Assembler& a, uint8_t ctrl) {
+    // Every sprite but sprite 0 drifts right
+    a.Op(LDX_IMM, 4);
+    a.Label("move_sprites");
+    a.OpW(LDA_ABX, OAM_BUF + 3);
+    a.Op(CLC);
+    a.Op(ADC_IMM, 1);
+    a.OpW(STA_ABX, OAM_BUF + 3);
+    a.Op(TXA);
+    a.Op(CLC);
+    a.Op(ADC_IMM, 4);
+    a.Op(TAX);
+    a.Branch(BNE, "move_sprites");
+
+    // Controller 1 ends up in ZP_PAD and moves sprite 1
+    a.Op(LDA_IMM, 0x01);
+    a.OpW(STA_ABS, 0x4016);
+    a.Op(LDA_IMM, 0x00);
+    a.OpW(STA_ABS, 0x4016);
+    a.Op(LDX_IMM, 8);
+    a.Label("read_pad");
+    a.OpW(LDA_ABS, 0x4016);
+    a.Op(LSR_ACC);
+    a.Op(ROL_ZPG, ZP_PAD);
+    a.Op(DEX);
+    a.Branch(BNE, "read_pad");
+    a.Op(LDA_ZPG, ZP_PAD);
+    a.OpW(STA_ABS, OAM_BUF + 4);
+
+    a.Op(LDA_ZPG, ZP_FRAME);
+    a.OpW(STA_ABS, 0x4002);
+    a.Op(EOR_IMM, 0xff);
+    a.OpW(STA_ABS, 0x4006);
+
+    // Flip to the other nametable every 64 frames
+    a.Op(LDA_ZPG, ZP_FRAME);
+    a.Op(AND_IMM, 0x40);
+    a.Branch(BEQ, "nmi_nt0");
+    a.Op(LDA_IMM, 0x01);
+    a.Label("nmi_nt0");
+    a.Op(ORA_IMM, ctrl);
+    a.OpW(STA_ABS, 0x2000);
+    a.Op(LDA_ZPG, ZP_FRAME);
+    a.OpW(STA_ABS, 0x2005);
+    a.Op(LDA_IMM, 0x00);
+    a.OpW(STA_ABS, 0x2005);
+
+    a.Op(INC_ZPG, ZP_FRAME);
+    a.Op(LDA_IMM, 0x01);
+    a.Op(STA_ZPG, ZP_NMI_FLAG);
+}
+
+void EmitNMIReturn(Assembler& a) {
+    a.Op(PLA);
+    a.Op(TAY);
+    a.Op(PLA);
+    a.Op(TAX);
+    a.Op(PLA);
+    a.Op(RTI);
+}
+
+// Waits for the NMI handler to run, then sums the page at 0x8000 (which the
+// caller has just switched)
+void EmitWaitFrame(Assembler& a) {
+    a.Label("main");
+    a.Op(LDA_ZPG, ZP_NMI_FLAG);
+    a.Branch(BEQ, "main");
+    a.Op(LDA_IMM, 0x00);
+    a.Op(STA_ZPG, ZP_NMI_FLAG);
+    a.Op(INC_ZPG, ZP_BANK);
+}
+
+void EmitChecksumPage(Assembler& a) {
+    a.Op(LDY_IMM, 0x00);
+    a.Label("checksum");
+    a.OpW(LDA_ABY, 0x8000);
+    a.Op(CLC);
+    a.Op(ADC_ZPG, ZP_SUM);
+    a.Op(STA_ZPG, ZP_SUM);
+    a.Op(INY);
+    a.Branch(BNE, "checksum");
+    a.OpL(JMP_ABS, "main");
+}
+
+void EmitTables(Assembler& a) {
+    a.Label("palette");
+    a.Bytes(PALETTE);
+    a.Label("oam_init");
+    a.Bytes(MakeOAMTable());
+}
+
+/* The ROMs */
+std::vector<uint8_t> BuildCPU() {
+    Assembler a(0x8000);
+    EmitPrologue(a);
+
+    // Seed the work area and the indirect pointer
+    a.Op(LDX_IMM, 0x00);
+    a.Label("seed");
+    a.Op(TXA);
+    a.OpW(STA_ABX, 0x0200);
+    a.Op(INX);
+    a.Branch(BNE, "seed");
+    a.Op(LDA_IMM, 0x00);
+    a.Op(STA_ZPG, ZP_PTR);
+    a.Op(LDA_IMM, 0x03);
+    a.Op(STA_ZPG, ZP_PTR + 1);
+
+    a.Label("main");
+    a.Op(LDX_IMM, 0x00);
+    a.Label("mix");
+    a.OpW(LDA_ABX, 0x0200);
+    a.Op(CLC);
+    a.Op(ADC_ZPG, ZP_FRAME);
+    a.OpW(STA_ABX, 0x0200);
+    a.Op(EOR_IDY, ZP_PTR);
+    a.Op(STA_ZPG, ZP_SPLIT);
+    a.Op(INY);
+    a.Op(ROL_ACC);
+    a.Op(AND_IMM, 0x3f);
+    a.Op(TAY);
+    a.Op(INX);
+    a.Branch(BNE, "mix");
+
+    a.OpL(JSR, "shifts");
+
+    a.Op(LDA_ZPG, ZP_FRAME);
+    a.Op(SEC);
+    a.Op(SBC_IMM, 3);
+    a.Op(STA_ZPG, ZP_FRAME);
+    a.Branch(BCS, "no_borrow");
+    a.Op(INC_ZPG, ZP_LOOPS);
+    a.Label("no_borrow");
+
+    a.Op(LDY_IMM, 0x00);
+    a.Label("table");
+    a.OpL(LDA_ABY, "oam_init");
+    a.Op(CMP_IMM, 0x80);
+    a.Branch(BCC, "table_lo");
+    a.Op(LSR_ACC);
+    a.Label("table_lo");
+    a.OpW(ADC_ABX, 0x0200);
+    a.Op(STA_IDY, ZP_PTR);
+    a.Op(INY);
+    a.Branch(BNE, "table");
+
+    a.Op(PHA);
+    a.Op(PHP);
+    a.Op(PLP);
+    a.Op(PLA);
+    a.Branch(BMI, "indirect");
+    a.Branch(BVC, "indirect");
+    a.Branch(BVS, "indirect");
+    a.Label("indirect");
+    a.OpL(JMP_IND, "main_vector");
+
+    a.Label("shifts");
+    a.Op(LDX_IMM, 8);
+    a.Label("shift_loop");
+    a.Op(ASL_ZPG, ZP_SCRATCH);
+    a.Op(ROR_ZPG, ZP_SCRATCH + 1);
+    a.Op(ROL_ZPG, ZP_SCRATCH + 2);
+    a.Op(LSR_ZPG, ZP_SCRATCH + 3);
+    a.Op(ASL_ACC);
+    a.Op(DEX);
+    a.Branch(BNE, "shift_loop");
+    a.Op(RTS);
+
+    a.Label("irq");
+    a.Label("nmi");
+    a.Op(RTI);
+
+    a.Label("main_vector");
+    a.WordL("main");
+    EmitTables(a);
+
+    auto prg = a.Link(0x8000);
+    Assembler::SetVectors(prg, a.Addr("nmi"), a.Addr("reset"), a.Addr("irq"));
+    return MakeINES(0, true, prg, MakeCHR(0x2000));
+}
+
+std::vector<uint8_t> BuildPPU() {
+    constexpr uint8_t ctrl = 0x90;
+    Assembler a(0x8000);
+    EmitPrologue(a);
+    EmitPPUSetup(a);
+    EmitAudioSetup(a);
+    EmitEnableRendering(a, ctrl);
+
+    // Split the screen at sprite 0 every frame
+    a.Label("main");
+    a.Label("wait_spr0_clear");
+    a.OpW(BIT_ABS, 0x2002);
+    a.Branch(BVS, "wait_spr0_clear");
+    a.Label("wait_spr0_hit");
+    a.OpW(BIT_ABS, 0x2002);
+    a.Branch(BVC, "wait_spr0_hit");
+    a.Op(LDA_ZPG, ZP_SPLIT);
+    a.OpW(STA_ABS, 0x2005);
+    a.OpW(STA_ABS, 0x2005);
+    a.Op(INC_ZPG, ZP_SPLIT);
+    a.OpL(JMP_ABS, "main");
+
+    EmitNMIStart(a);
+    EmitNMIFinish(a, ctrl);
+    EmitNMIReturn(a);
+
+    a.Label("irq");
+    a.Op(RTI);
+    EmitTables(a);
+
+    auto prg = a.Link(0x8000);
+    Assembler::SetVectors(prg, a.Addr("nmi"), a.Addr("reset"), a.Addr("irq"));
+    return MakeINES(0, true, prg, MakeCHR(0x2000));
+}
+
+std::vector<uint8_t> BuildMMC3() {
+    // 8x16 sprites, background from 0x1000
+    constexpr uint8_t ctrl = 0xb0;
+    constexpr uint8_t irq_latch = 31;
+    Assembler a(0xe000);
+    EmitPrologue(a);
+
+    // R0-R5 are the CHR banks, R6/R7 the switchable PRG banks
+    a.Op(LDX_IMM, 0x00);
+    a.Label("init_banks");
+    a.Op(TXA);
+    a.OpW(STA_ABS, 0x8000);
+    a.OpL(LDA_ABX, "bank_init");
+    a.OpW(STA_ABS, 0x8001);
+    a.Op(INX);
+    a.Op(CPX_IMM, 8);
+    a.Branch(BNE, "init_banks");
+    a.Op(LDA_IMM, 0x00);
+    a.OpW(STA_ABS, 0xa000);
+
+    EmitPPUSetup(a);
+    EmitAudioSetup(a);
+
+    a.Op(LDA_IMM, irq_latch);
+    a.OpW(STA_ABS, 0xc000);
+    a.OpW(STA_ABS, 0xc001);
+    a.OpW(STA_ABS, 0xe001);
+    a.Op(CLI);
+    EmitEnableRendering(a, ctrl);
+
+    EmitWaitFrame(a);
+    a.Op(LDA_IMM, 0x06);
+    a.OpW(STA_ABS, 0x8000);
+    a.Op(LDA_ZPG, ZP_BANK);
+    a.Op(AND_IMM, 0x03);
+    a.OpW(STA_ABS, 0x8001);
+    EmitChecksumPage(a);
+
+    EmitNMIStart(a);
+    EmitNMIFinish(a, ctrl);
+    a.Op(LDA_IMM, irq_latch);
+    a.OpW(STA_ABS, 0xc000);
+    a.OpW(STA_ABS, 0xc001);
+    EmitNMIReturn(a);
+
+    // Every 32 lines, swap the first 1k of background tiles
+    a.Label("irq");
+    a.Op(PHA);
+    a.OpW(STA_ABS, 0xe000);
+    a.OpW(STA_ABS, 0xe001);
+    a.Op(INC_ZPG, ZP_IRQS);
+    a.Op(LDA_IMM, 0x02);
+    a.OpW(STA_ABS, 0x8000);
+    a.Op(LDA_ZPG, ZP_IRQS);
+    a.Op(AND_IMM, 0x3f);
+    a.OpW(STA_ABS, 0x8001);
+    a.Op(PLA);
+    a.Op(RTI);
+
+    a.Label("bank_init");
+    a.Bytes({ 0, 2, 4, 5, 6, 7, 0, 1 });
+    EmitTables(a);
+
+    // 8 x 8k PRG banks, the last one holds the code
+    std::vector<uint8_t> prg;
+    for (int bank = 0; bank < 7; bank++) {
+        auto data = MakeDataBank(0x2000, bank);
+        prg.insert(prg.end(), data.begin(), data.end());
+    }
+    auto code = a.Link(0x2000);
+    Assembler::SetVectors(code, a.Addr("nmi"), a.Addr("reset"), a.Addr("irq"));
+    prg.insert(prg.end(), code.begin(), code.end());
+    return MakeINES(4, false, prg, MakeCHR(0x10000));
+}
+
+std::vector<uint8_t> BuildUxROM() {
+    constexpr uint8_t ctrl = 0x90;
+    Assembler a(0xc000);
+    EmitPrologue(a);
+
+    // Fill all 8k of CHR RAM
+    a.Op(LDA_IMM, 0x00);
+    a.OpW(STA_ABS, 0x2006);
+    a.OpW(STA_ABS, 0x2006);
+    a.Op(LDY_IMM, 32);
+    a.Label("fill_chr_page");
+    a.Op(STY_ZPG, ZP_TMP);
+    a.Op(LDX_IMM, 0x00);
+    a.Label("fill_chr");
+    a.Op(TXA);
+    a.Op(EOR_ZPG, ZP_TMP);
+    a.Op(ASL_ACC);
+    a.OpW(STA_ABS, 0x2007);
+    a.Op(INX);
+    a.Branch(BNE, "fill_chr");
+    a.Op(DEY);
+    a.Branch(BNE, "fill_chr_page");
+
+    EmitPPUSetup(a);
+    EmitAudioSetup(a);
+    EmitEnableRendering(a, ctrl);
+
+    EmitWaitFrame(a);
+    a.Op(LDA_ZPG, ZP_BANK);
+    a.Op(AND_IMM, 0x07);
+    a.OpW(STA_ABS, 0x8000);
+    EmitChecksumPage(a);
+
+    // Rewrite one background tile every frame
+    EmitNMIStart(a);
+    a.Op(LDA_ZPG, ZP_FRAME);
+    a.Op(LSR_ACC);
+    a.Op(LSR_ACC);
+    a.Op(LSR_ACC);
+    a.Op(LSR_ACC);
+    a.Op(ORA_IMM, 0x10);
+    a.OpW(STA_ABS, 0x2006);
+    a.Op(LDA_ZPG, ZP_FRAME);
+    a.Op(ASL_ACC);
+    a.Op(ASL_ACC);
+    a.Op(ASL_ACC);
+    a.Op(ASL_ACC);
+    a.OpW(STA_ABS, 0x2006);
+    a.Op(LDX_IMM, 16);
+    a.Label("write_tile");
+    a.Op(TXA);
+    a.Op(EOR_ZPG, ZP_FRAME);
+    a.OpW(STA_ABS, 0x2007);
+    a.Op(DEX);
+    a.Branch(BNE, "write_tile");
+    EmitNMIFinish(a, ctrl);
+    EmitNMIReturn(a);
+
+    a.Label("irq");
+    a.Op(RTI);
+    EmitTables(a);
+
+    // 8 x 16k PRG banks, the last one fixed at 0xc000
+    std::vector<uint8_t> prg;
+    for (int bank = 0; bank < 7; bank++) {
+        auto data = MakeDataBank(0x4000, bank);
+        prg.insert(prg.end(), data.begin(), data.end());
+    }
+    auto code = a.Link(0x4000);
+    Assembler::SetVectors(code, a.Addr("nmi"), a.Addr("reset"), a.Addr("irq"));
+    prg.insert(prg.end(), code.begin(), code.end());
+    return MakeINES(2, true, prg, {});
+}
+
+std::vector<uint8_t> BuildMMC1() {
+    constexpr uint8_t ctrl = 0x90;
+    Assembler a(0xc000);
+
+    auto set_target = [&a](uint16_t addr) {
+        a.Op(LDA_IMM, addr & 0xff);
+        a.Op(STA_ZPG, ZP_PTR);
+        a.Op(LDA_IMM, addr >> 8);
+        a.Op(STA_ZPG, ZP_PTR + 1);
+    };
+
+    EmitPrologue(a);
+    a.Op(LDA_IMM, 0x80);
+    a.OpW(STA_ABS, 0x8000);
+    // 4k CHR banks, 16k PRG at 0x8000 with the last bank fixed, vertical
+    set_target(0x8000);
+    a.Op(LDA_IMM, 0x1e);
+    a.OpL(JSR, "mmc1_write");
+    set_target(0xa000);
+    a.Op(LDA_IMM, 0x00);
+    a.OpL(JSR, "mmc1_write");
+    set_target(0xc000);
+    a.Op(LDA_IMM, 0x01);
+    a.OpL(JSR, "mmc1_write");
+
+    EmitPPUSetup(a);
+    EmitAudioSetup(a);
+    EmitEnableRendering(a, ctrl);
+
+    EmitWaitFrame(a);
+    set_target(0xe000);
+    a.Op(LDA_ZPG, ZP_BANK);
+    a.Op(AND_IMM, 0x07);
+    a.OpL(JSR, "mmc1_write");
+    EmitChecksumPage(a);
+
+    EmitNMIStart(a);
+    EmitNMIFinish(a, ctrl);
+    // Background bank changes every 8 frames, mirroring every 64
+    set_target(0xc000);
+    a.Op(LDA_ZPG, ZP_FRAME);
+    a.Op(LSR_ACC);
+    a.Op(LSR_ACC);
+    a.Op(LSR_ACC);
+    a.Op(AND_IMM, 0x07);
+    a.OpL(JSR, "mmc1_write");
+    set_target(0x8000);
+    a.Op(LDA_ZPG, ZP_FRAME);
+    a.Op(AND_IMM, 0x40);
+    a.Branch(BEQ, "mirror_vertical");
+    a.Op(LDA_IMM, 0x01);
+    a.Label("mirror_vertical");
+    a.Op(ORA_IMM, 0x1e);
+    a.OpL(JSR, "mmc1_write");
+    EmitNMIReturn(a);
+
+    // Shifts A into the register at (ZP_PTR), one bit per write
+    a.Label("mmc1_write");
+    a.Op(LDY_IMM, 0x00);
+    for (int i = 0; i < 5; i++) {
+        a.Op(STA_IDY, ZP_PTR);
+        if (i != 4)
+            a.Op(LSR_ACC);
+    }
+    a.Op(RTS);
+
+    a.Label("irq");
+    a.Op(RTI);
+    EmitTables(a);
+
+    std::vector<uint8_t> prg;
+    for (int bank = 0; bank < 7; bank++) {
+        auto data = MakeDataBank(0x4000, bank);
+        prg.insert(prg.end(), data.begin(), data.end());
+    }
+    auto code = a.Link(0x4000);
+    Assembler::SetVectors(code, a.Addr("nmi"), a.Addr("reset"), a.Addr("irq"));
+    prg.insert(prg.end(), code.begin(), code.end());
+    return MakeINES(1, true, prg, MakeCHR(0x8000));
+}
+}
+
+const std::vector<std::string>& SyntheticROM_Names() {
+    static const std::vector<std::string> names = {
+        "cpu", "ppu", "mmc3", "uxrom", "mmc1"
+    };
+    return names;
+}
+
+std::vector<uint8_t> SyntheticROM_Build(const std::string& name) {
+    if (name == "cpu")
+        return BuildCPU();
+    if (name == "ppu")
+        return BuildPPU();
+    if (name == "mmc3")
+        return BuildMMC3();
+    if (name == "uxrom")
+        return BuildUxROM();
+    if (name == "mmc1")
+        return BuildMMC1();
+    return {};
+}
+
+bool SyntheticROM_LoadWorkload(Bus& bus, const std::string& spec) {
+    static const std::string prefix = "synthetic:";
+
+    bus.PowerOn();
+    if (spec.compare(0, prefix.size(), prefix) == 0) {
+        auto rom = SyntheticROM_Build(spec.substr(prefix.size()));
+        if (rom.empty()) {
+            Util_Log(Util_LogLevel::ERROR, Util_LogCategory::ERROR,
+                "SyntheticROM_LoadWorkload: no synthetic rom named " + spec);
+            return false;
+        }
+        if (!bus.GetCart().LoadROMStr(reinterpret_cast<const char*>(rom.data())))
+            return false;
+    } else if (!bus.GetCart().LoadROM(spec.c_str())) {
+        return false;
+    }
+
+    if (bus.GetCart().GetMapper() == nullptr) {
+        Util_Log(Util_LogLevel::ERROR, Util_LogCategory::ERROR,
+            "SyntheticROM_LoadWorkload: unsupported mapper in " + spec);
+        return false;
+    }
+    bus.Reset();
+    return true;
+}
+}
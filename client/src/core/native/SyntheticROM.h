@@ -0,0 +1,44 @@
+/*
+ * Copyright 2023 Edward C. Pinkston
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SYNTHETICROM_H_
+#define SYNTHETICROM_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../NESCLETypes.h"
+
+// Small iNES images assembled in code, so the native tools have workloads
+// that don't depend on anybody's ROM collection. Each one is built to lean
+// on a different part of the core:
+//   cpu   - NROM, rendering off, a loop over most addressing modes
+//   ppu   - NROM, BG + 64 sprites, sprite 0 split, OAM DMA, all 5 channels
+//   mmc3  - MMC3 scanline IRQs, CHR banks swapped mid frame, 8x16 sprites
+//   uxrom - UxROM with CHR RAM rewritten every frame, PRG bank switching
+//   mmc1  - MMC1 serial writes, 4k CHR banks and mirroring changes
+namespace NESCLE {
+const std::vector<std::string>& SyntheticROM_Names();
+
+// Returns an empty vector if there is no synthetic ROM with that name
+std::vector<uint8_t> SyntheticROM_Build(const std::string& name);
+
+// Loads either a synthetic ROM ("synthetic:<name>") or a .nes file into the
+// bus and brings the system up the same way the web front end does
+// (PowerOn, insert cart, Reset)
+bool SyntheticROM_LoadWorkload(Bus& bus, const std::string& spec);
+}
+#endif // SYNTHETICROM_H_